@@ -1,10 +1,15 @@
 #include "godiceapi.h"
 #include <string.h>
 #include <stdbool.h>
+#include <stdatomic.h>
+#ifndef GODICE_INTEGER_ONLY
 #include <float.h>
 #include <math.h>
+#endif
 
 //#define LOGGING
+// Classify faces without floating point math, for targets without FPU (set by GODICE_EMBEDDED)
+//#define GODICE_INTEGER_ONLY
 
 #if defined __ANDROID__ && defined LOGGING
 	#include <android/log.h>
@@ -218,22 +223,107 @@ static int d10x_transform(int roll) {
 }
 
 typedef struct {
-	const int max;
+	int max;
 	const axis_t *values;
-	const int values_num;
+	int values_num;
 	int (*transform)(int roll);
+	// Face index -> value table, used instead of `transform` by registered dice types
+	const uint8_t *face_values;
+	const char *name;
 } diceType_t;
 
 static diceType_t DiceTypes[] = {
-	{4, D24Values, countof(D24Values), d4_transform},
-	{6, D6Values, countof(D6Values), identity_transform},
-	{8, D24Values, countof(D24Values), d8_transform},
-	{10, D20Values, countof(D20Values), d10_transform},
-	{12, D24Values, countof(D24Values), d12_transform},
-	{20, D20Values, countof(D20Values), identity_transform},
-	{100, D20Values, countof(D20Values), d10x_transform},
+	{4, D24Values, countof(D24Values), d4_transform, NULL, "D4"},
+	{6, D6Values, countof(D6Values), identity_transform, NULL, "D6"},
+	{8, D24Values, countof(D24Values), d8_transform, NULL, "D8"},
+	{10, D20Values, countof(D20Values), d10_transform, NULL, "D10"},
+	{12, D24Values, countof(D24Values), d12_transform, NULL, "D12"},
+	{20, D20Values, countof(D20Values), identity_transform, NULL, "D20"},
+	{100, D20Values, countof(D20Values), d10x_transform, NULL, "D10X"},
 };
 
+typedef struct {
+	diceType_t type;
+	axis_t values[GODICE_MAX_DICE_FACES];
+	uint8_t face_values[GODICE_MAX_DICE_FACES];
+	char name[GODICE_DICE_TYPE_NAME_SIZE];
+} registeredDiceType_t;
+
+static registeredDiceType_t RegisteredDiceTypes[GODICE_REGISTERED_DICE_TYPES_MAX];
+static size_t RegisteredDiceTypesNum = 0;
+static atomic_flag RegistrationLock = ATOMIC_FLAG_INIT;
+
+// Dice type by `dice_max`. Entries are published once and never modified afterwards,
+// so decoding threads only need an acquire load.
+static const diceType_t *_Atomic DiceTypeById[GODICE_DICE_TYPE_ID_MAX + 1] = {
+	[4] = &DiceTypes[0],
+	[6] = &DiceTypes[1],
+	[8] = &DiceTypes[2],
+	[10] = &DiceTypes[3],
+	[12] = &DiceTypes[4],
+	[20] = &DiceTypes[5],
+	[100] = &DiceTypes[6],
+};
+
+static const diceType_t *find_dice_type(int dice_max) {
+	if (dice_max < 0 || dice_max > GODICE_DICE_TYPE_ID_MAX) {
+		return NULL;
+	}
+	return atomic_load_explicit(&DiceTypeById[dice_max], memory_order_acquire);
+}
+
+static int dice_type_value(const diceType_t *dice_type, int raw_roll) {
+	if (dice_type->face_values != NULL) {
+		return dice_type->face_values[raw_roll - 1];
+	}
+	return dice_type->transform(raw_roll);
+}
+
+godice_status_t godice_register_dice_type(int dice_max, const char *name,
+										  const godice_axis_t *faces, const uint8_t *face_values,
+										  size_t faces_num) {
+	if (dice_max < 0 || dice_max > GODICE_DICE_TYPE_ID_MAX ||
+		faces == NULL || face_values == NULL ||
+		faces_num == 0 || faces_num > GODICE_MAX_DICE_FACES) {
+		return GODICE_INVALID_ARGUMENT;
+	}
+	while (atomic_flag_test_and_set_explicit(&RegistrationLock, memory_order_acquire)) {
+	}
+	godice_status_t status = GODICE_OK;
+	if (atomic_load_explicit(&DiceTypeById[dice_max], memory_order_relaxed) != NULL) {
+		status = GODICE_INVALID_ARGUMENT;
+	} else if (RegisteredDiceTypesNum >= countof(RegisteredDiceTypes)) {
+		status = GODICE_LIMIT_REACHED;
+	} else {
+		registeredDiceType_t *registered = &RegisteredDiceTypes[RegisteredDiceTypesNum++];
+		for (size_t i = 0; i < faces_num; i++) {
+			registered->values[i].x = faces[i].x;
+			registered->values[i].y = faces[i].y;
+			registered->values[i].z = faces[i].z;
+			registered->face_values[i] = face_values[i];
+		}
+		registered->name[0] = '\0';
+		if (name != NULL) {
+			strncat(registered->name, name, sizeof(registered->name) - 1);
+		}
+		registered->type.max = dice_max;
+		registered->type.values = registered->values;
+		registered->type.values_num = (int)faces_num;
+		registered->type.transform = NULL;
+		registered->type.face_values = registered->face_values;
+		registered->type.name = registered->name;
+		atomic_store_explicit(&DiceTypeById[dice_max], &registered->type, memory_order_release);
+	}
+	atomic_flag_clear_explicit(&RegistrationLock, memory_order_release);
+	return status;
+}
+
+const char *godice_dice_type_name(int dice_max) {
+	const diceType_t *dice_type = find_dice_type(dice_max);
+	return dice_type == NULL ? NULL : dice_type->name;
+}
+
+#ifndef GODICE_INTEGER_ONLY
 static float axis_distance(const axis_t *from, const axis_t *to) {
 	float x = (float)to->x - (float)from->x;
 	float y = (float)to->y - (float)from->y;
@@ -255,6 +345,98 @@ static int axis_to_value(const axis_t values[], size_t values_num, const axis_t
 	}
 	return value;
 }
+#endif
+
+static int32_t axis_distance_sq(const axis_t *from, const axis_t *to) {
+	int32_t x = (int32_t)to->x - (int32_t)from->x;
+	int32_t y = (int32_t)to->y - (int32_t)from->y;
+	int32_t z = (int32_t)to->z - (int32_t)from->z;
+	return x * x + y * y + z * z;
+}
+
+typedef struct {
+	int face;
+	int value;
+	int32_t dist;
+	int32_t runner_up_dist;
+} nearestFace_t;
+
+static void nearest_face_init(nearestFace_t *nearest) {
+	nearest->face = 0;
+	nearest->value = 0;
+	nearest->dist = INT32_MAX;
+	nearest->runner_up_dist = INT32_MAX;
+}
+
+// Keeps the nearest face and the distance to the nearest face reporting a different value.
+// Ties resolve to the first face added, as in `axis_to_value`.
+static void nearest_face_add(nearestFace_t *nearest, const diceType_t *dice_type, int face, int32_t dist) {
+	if (dist >= nearest->runner_up_dist) {
+		return;
+	}
+	int value = dice_type_value(dice_type, face);
+	if (dist < nearest->dist) {
+		if (value != nearest->value) {
+			nearest->runner_up_dist = nearest->dist;
+		}
+		nearest->face = face;
+		nearest->value = value;
+		nearest->dist = dist;
+	} else if (value != nearest->value) {
+		nearest->runner_up_dist = dist;
+	}
+}
+
+static void nearest_face_result(const nearestFace_t *nearest, int scale_sq, godice_classification_t *result) {
+	result->face = (uint8_t)nearest->face;
+	result->value = (uint8_t)nearest->value;
+	result->distance_sq = nearest->dist / scale_sq;
+	result->margin_sq = nearest->runner_up_dist == INT32_MAX
+		? INT32_MAX
+		: (nearest->runner_up_dist - nearest->dist) / scale_sq;
+}
+
+// Picks the same face as `axis_to_value`: squared distances of int8 axes are exact
+// and sqrtf is monotonic.
+static void classify_faces(const diceType_t *dice_type, const axis_t *axis,
+						   godice_classification_t *result) {
+	nearestFace_t nearest;
+	nearest_face_init(&nearest);
+	for (int i = 0; i < dice_type->values_num; i++) {
+		nearest_face_add(&nearest, dice_type, i + 1, axis_distance_sq(axis, &dice_type->values[i]));
+	}
+	nearest_face_result(&nearest, 1, result);
+}
+
+static int32_t centroid_distance_sq(const axis_t *axis, const int16_t centroid[3]) {
+	int32_t x = (int32_t)axis->x * GODICE_CALIBRATION_SCALE - centroid[0];
+	int32_t y = (int32_t)axis->y * GODICE_CALIBRATION_SCALE - centroid[1];
+	int32_t z = (int32_t)axis->z * GODICE_CALIBRATION_SCALE - centroid[2];
+	return x * x + y * y + z * z;
+}
+
+static void classify_calibrated(const diceType_t *dice_type, const godice_calibration_t *calibration,
+								const axis_t *axis, godice_classification_t *result) {
+	nearestFace_t nearest;
+	nearest_face_init(&nearest);
+	for (int i = 0; i < dice_type->values_num; i++) {
+		nearest_face_add(&nearest, dice_type, i + 1, centroid_distance_sq(axis, calibration->centroids[i]));
+	}
+	nearest_face_result(&nearest, GODICE_CALIBRATION_SCALE * GODICE_CALIBRATION_SCALE, result);
+}
+
+static void calibration_learn(godice_calibration_t *calibration, int face, const axis_t *axis) {
+	int16_t *centroid = calibration->centroids[face - 1];
+	uint16_t samples = calibration->samples[face - 1];
+	// Running mean for the first samples, exponential moving average afterwards
+	int32_t divisor = samples + 1 < GODICE_CALIBRATION_WINDOW ? samples + 1 : GODICE_CALIBRATION_WINDOW;
+	centroid[0] += (int16_t)(((int32_t)axis->x * GODICE_CALIBRATION_SCALE - centroid[0]) / divisor);
+	centroid[1] += (int16_t)(((int32_t)axis->y * GODICE_CALIBRATION_SCALE - centroid[1]) / divisor);
+	centroid[2] += (int16_t)(((int32_t)axis->z * GODICE_CALIBRATION_SCALE - centroid[2]) / divisor);
+	if (samples < UINT16_MAX) {
+		calibration->samples[face - 1] = samples + 1;
+	}
+}
 
 static bool is_event_prefix(const uint8_t *packet, size_t size, const char *key) {
 	size_t key_len = strlen(key);
@@ -265,14 +447,23 @@ static bool is_event_prefix(const uint8_t *packet, size_t size, const char *key)
 }
 
 static godice_status_t incoming_roll_packet(const godice_callbacks_t *cb, void *cb_userdata,
-											int dice_id, const uint8_t *packet, size_t size) {
+											godice_dice_state_t *state, int dice_id, size_t size) {
+	if (size == 0) {
+		return GODICE_INVALID_PACKET;
+	}
+	// Tracked state is updated without roll callback too, next stable depends on it
+	bool was_rolling = false;
+	if (state != NULL) {
+		was_rolling = state->rolling;
+		state->rolling = true;
+		state->stable = false;
+	}
 	if (cb->on_dice_roll == NULL) {
 		return GODICE_INVALID_CALLBACK;
 	}
-	if (size == 0) {
-		return GODICE_INVALID_PACKET;
+	if (!was_rolling) {
+		cb->on_dice_roll(cb_userdata, dice_id);
 	}
-	cb->on_dice_roll(cb_userdata, dice_id);
 	return GODICE_OK;
 }
 
@@ -281,11 +472,98 @@ typedef struct __attribute__((__packed__)) {
 	axis_t axis;
 } stablePacket_t;
 
+#ifdef LOGGING
+static const char StableKindSymbol[] = { ' ', 'F', 'M', 'T' };
+#endif
+
+static bool classify_axis(int dice_max, godice_calibration_t *calibration,
+						  const axis_t *axis, godice_stable_kind_t kind, int *value) {
+	const diceType_t *dice_type = find_dice_type(dice_max);
+	if (dice_type == NULL) {
+		return false;
+	}
+	if (calibration != NULL && calibration->dice_max == dice_max) {
+		godice_classification_t result;
+		classify_calibrated(dice_type, calibration, axis, &result);
+		if (calibration->learning && kind == GODICE_STABLE &&
+			result.margin_sq >= GODICE_CALIBRATION_MIN_MARGIN_SQ) {
+			calibration_learn(calibration, result.face, axis);
+		}
+		*value = result.value;
+		return true;
+	}
+#ifdef GODICE_INTEGER_ONLY
+	godice_classification_t result;
+	classify_faces(dice_type, axis, &result);
+	*value = result.value;
+#else
+	int raw_roll = axis_to_value(dice_type->values, dice_type->values_num, axis);
+	*value = dice_type_value(dice_type, raw_roll);
+#endif
+	return true;
+}
+
+godice_status_t godice_classify_axis(int dice_max, const godice_axis_t *axis,
+									 godice_classification_t *result) {
+	const diceType_t *dice_type = find_dice_type(dice_max);
+	if (dice_type == NULL) {
+		return GODICE_INVALID_ARGUMENT;
+	}
+	axis_t packed_axis = { axis->x, axis->y, axis->z };
+	classify_faces(dice_type, &packed_axis, result);
+	return GODICE_OK;
+}
+
+godice_status_t godice_dice_values(int dice_max, uint8_t *values, size_t values_size, size_t *values_num) {
+	const diceType_t *dice_type = find_dice_type(dice_max);
+	if (dice_type == NULL) {
+		return GODICE_INVALID_ARGUMENT;
+	}
+	bool seen[256] = { false };
+	for (int raw_roll = 1; raw_roll <= dice_type->values_num; raw_roll++) {
+		seen[(uint8_t)dice_type_value(dice_type, raw_roll)] = true;
+	}
+	size_t count = 0;
+	for (size_t value = 0; value < countof(seen); value++) {
+		if (!seen[value]) {
+			continue;
+		}
+		if (count >= values_size) {
+			return GODICE_BUFFER_TOO_SMALL;
+		}
+		values[count++] = (uint8_t)value;
+	}
+	*values_num = count;
+	return GODICE_OK;
+}
+
+static bool should_report_stable(godice_dice_state_t *state, int number, godice_stable_kind_t kind) {
+	if (state == NULL) {
+		return true;
+	}
+	bool changed = state->rolling || !state->stable || state->number != number;
+	bool confirmed = kind == GODICE_STABLE && state->kind != GODICE_STABLE;
+	state->rolling = false;
+	if (!changed && !confirmed) {
+		return false;
+	}
+	state->stable = true;
+	state->number = (uint8_t)number;
+	state->kind = kind;
+	return true;
+}
+
 static godice_status_t incoming_stable_packet(const godice_callbacks_t *cb, void *cb_userdata,
+								   godice_dice_state_t *state,
 								   int dice_id, int dice_max,
 								   const uint8_t *raw_packet, size_t size,
-								   const char *stable_type) {
-	if (cb->on_dice_stable == NULL) {
+								   godice_stable_kind_t kind) {
+	if (cb->on_dice_stable == NULL && cb->on_dice_stable_kind == NULL) {
+		// The roll is over even though nobody listens to results
+		if (state != NULL) {
+			state->rolling = false;
+			state->stable = false;
+		}
 		return GODICE_INVALID_CALLBACK;
 	}
 	if (size != sizeof(stablePacket_t)) {
@@ -293,19 +571,133 @@ static godice_status_t incoming_stable_packet(const godice_callbacks_t *cb, void
 	}
 	stablePacket_t *packet = (stablePacket_t*)raw_packet;
 	log("%cS (%-3d, %-3d, %-3d)",
-		stable_type == NULL ? ' ' : *stable_type,
+		StableKindSymbol[kind],
 		(int)packet->axis.x,
 		(int)packet->axis.y,
 		(int)packet->axis.z);
-	for (int i = 0; i < countof(DiceTypes); i++) {
-		diceType_t *dice_type = &DiceTypes[i];
-		if (dice_max == dice_type->max) {
-			int raw_roll = axis_to_value(dice_type->values, dice_type->values_num, &packet->axis);
-			int transformed_roll = dice_type->transform(raw_roll);
-			cb->on_dice_stable(cb_userdata, dice_id, transformed_roll);
-			break;
+	int number;
+	godice_calibration_t *calibration = state == NULL ? NULL : state->calibration;
+	if (!classify_axis(dice_max, calibration, &packet->axis, kind, &number)) {
+		return GODICE_OK;
+	}
+	if (!should_report_stable(state, number, kind)) {
+		return GODICE_OK;
+	}
+	if (cb->on_dice_stable != NULL) {
+		cb->on_dice_stable(cb_userdata, dice_id, number);
+	}
+	if (cb->on_dice_stable_kind != NULL) {
+		cb->on_dice_stable_kind(cb_userdata, dice_id, number, kind);
+	}
+	return GODICE_OK;
+}
+
+godice_status_t godice_classify_stable_packet(int dice_max, const uint8_t *packet, size_t size,
+											  godice_classification_t *result) {
+	if (is_event_prefix(packet, size, EK_FakeStable) ||
+		is_event_prefix(packet, size, EK_MoveStable) ||
+		is_event_prefix(packet, size, EK_TiltStable)) {
+		packet++;
+		size--;
+	}
+	if (!is_event_prefix(packet, size, EK_Stable) || size != sizeof(stablePacket_t)) {
+		return GODICE_INVALID_PACKET;
+	}
+	const stablePacket_t *stable_packet = (const stablePacket_t*)packet;
+	godice_axis_t axis = { stable_packet->axis.x, stable_packet->axis.y, stable_packet->axis.z };
+	return godice_classify_axis(dice_max, &axis, result);
+}
+
+godice_status_t godice_calibration_init(godice_calibration_t *calibration, int dice_max) {
+	const diceType_t *dice_type = find_dice_type(dice_max);
+	if (dice_type == NULL) {
+		return GODICE_INVALID_ARGUMENT;
+	}
+	calibration->dice_max = dice_max;
+	calibration->faces_num = (uint8_t)dice_type->values_num;
+	calibration->learning = true;
+	for (int i = 0; i < GODICE_MAX_DICE_FACES; i++) {
+		bool is_face = i < dice_type->values_num;
+		calibration->centroids[i][0] = is_face ? dice_type->values[i].x * GODICE_CALIBRATION_SCALE : 0;
+		calibration->centroids[i][1] = is_face ? dice_type->values[i].y * GODICE_CALIBRATION_SCALE : 0;
+		calibration->centroids[i][2] = is_face ? dice_type->values[i].z * GODICE_CALIBRATION_SCALE : 0;
+		calibration->samples[i] = 0;
+	}
+	return GODICE_OK;
+}
+
+godice_status_t godice_calibration_classify_axis(godice_calibration_t *calibration,
+												 const godice_axis_t *axis,
+												 godice_classification_t *result) {
+	const diceType_t *dice_type = find_dice_type(calibration->dice_max);
+	if (dice_type == NULL || dice_type->values_num != calibration->faces_num) {
+		return GODICE_INVALID_ARGUMENT;
+	}
+	axis_t packed_axis = { axis->x, axis->y, axis->z };
+	classify_calibrated(dice_type, calibration, &packed_axis, result);
+	if (calibration->learning && result->margin_sq >= GODICE_CALIBRATION_MIN_MARGIN_SQ) {
+		calibration_learn(calibration, result->face, &packed_axis);
+	}
+	return GODICE_OK;
+}
+
+static void write_int16(uint8_t *buffer, int16_t value) {
+	buffer[0] = (uint8_t)((uint16_t)value & 0xff);
+	buffer[1] = (uint8_t)((uint16_t)value >> 8);
+}
+
+static int16_t read_int16(const uint8_t *buffer) {
+	return (int16_t)(buffer[0] | (buffer[1] << 8));
+}
+
+godice_status_t godice_calibration_export(const godice_calibration_t *calibration,
+										  uint8_t *buffer, size_t buffer_size, size_t *written_size) {
+	size_t size = GODICE_CALIBRATION_EXPORT_SIZE(calibration->faces_num);
+	if (buffer_size < size) {
+		return GODICE_BUFFER_TOO_SMALL;
+	}
+	buffer[0] = GODICE_CALIBRATION_EXPORT_VERSION;
+	buffer[1] = (uint8_t)calibration->dice_max;
+	buffer[2] = calibration->faces_num;
+	uint8_t *face = buffer + 3;
+	for (int i = 0; i < calibration->faces_num; i++, face += 8) {
+		write_int16(face, calibration->centroids[i][0]);
+		write_int16(face + 2, calibration->centroids[i][1]);
+		write_int16(face + 4, calibration->centroids[i][2]);
+		write_int16(face + 6, (int16_t)calibration->samples[i]);
+	}
+	*written_size = size;
+	return GODICE_OK;
+}
+
+godice_status_t godice_calibration_import(godice_calibration_t *calibration,
+										  const uint8_t *buffer, size_t size) {
+	if (size < 3 || buffer[0] != GODICE_CALIBRATION_EXPORT_VERSION ||
+		size != GODICE_CALIBRATION_EXPORT_SIZE(buffer[2])) {
+		return GODICE_INVALID_PACKET;
+	}
+	// Validated on a copy, the caller's calibration is kept if the buffer is rejected
+	godice_calibration_t imported;
+	godice_status_t status = godice_calibration_init(&imported, buffer[1]);
+	if (status != GODICE_OK) {
+		return status;
+	}
+	if (imported.faces_num != buffer[2]) {
+		return GODICE_INVALID_PACKET;
+	}
+	const uint8_t *face = buffer + 3;
+	for (int i = 0; i < imported.faces_num; i++, face += 8) {
+		for (int j = 0; j < 3; j++) {
+			int16_t value = read_int16(face + j * 2);
+			// Axis range, distances to farther centroids would overflow
+			if (value < -128 * GODICE_CALIBRATION_SCALE || value > 128 * GODICE_CALIBRATION_SCALE) {
+				return GODICE_INVALID_PACKET;
+			}
+			imported.centroids[i][j] = value;
 		}
+		imported.samples[i] = (uint16_t)read_int16(face + 6);
 	}
+	*calibration = imported;
 	return GODICE_OK;
 }
 
@@ -355,43 +747,120 @@ static godice_status_t incoming_color_packet(const godice_callbacks_t *cb, void
 	}
 }
 
-godice_status_t godice_incoming_packet(const godice_callbacks_t *cb, void *cb_userdata,
-									   int dice_id, int dice_max, const uint8_t *packet, size_t size) {
-	if (cb == NULL) {
-		return GODICE_INVALID_CALLBACK;
+static godice_status_t incoming_tap_packet(void (*on_tap)(void *userdata, int dice_id),
+										   void *cb_userdata, int dice_id) {
+	if (on_tap != NULL) {
+		on_tap(cb_userdata, dice_id);
 	}
-	if (is_event_prefix(packet, size, EK_Roll)) {
-		return incoming_roll_packet(cb, cb_userdata, dice_id, packet, size);
+	return GODICE_OK;
+}
+
+godice_event_t godice_packet_event(const uint8_t *packet, size_t size) {
+	if (size == 0) {
+		return GODICE_EVENT_NONE;
 	}
-	if (is_event_prefix(packet, size, EK_Tap)) {
-		return GODICE_OK;
+	switch (packet[0]) {
+		case 'R':
+			return is_event_prefix(packet, size, EK_Roll) ? GODICE_EVENT_ROLL : GODICE_EVENT_NONE;
+		case 'S':
+			return is_event_prefix(packet, size, EK_Stable) ? GODICE_EVENT_STABLE : GODICE_EVENT_NONE;
+		case 'F':
+			return is_event_prefix(packet, size, EK_FakeStable) ? GODICE_EVENT_FAKE_STABLE : GODICE_EVENT_NONE;
+		case 'M':
+			return is_event_prefix(packet, size, EK_MoveStable) ? GODICE_EVENT_MOVE_STABLE : GODICE_EVENT_NONE;
+		case 'T':
+			if (is_event_prefix(packet, size, EK_TiltStable)) {
+				return GODICE_EVENT_TILT_STABLE;
+			}
+			return is_event_prefix(packet, size, EK_Tap) ? GODICE_EVENT_TAP : GODICE_EVENT_NONE;
+		case 'D':
+			return is_event_prefix(packet, size, EK_DoubleTap) ? GODICE_EVENT_DOUBLE_TAP : GODICE_EVENT_NONE;
+		case 'B':
+			return is_event_prefix(packet, size, EK_Battery) ? GODICE_EVENT_BATTERY : GODICE_EVENT_NONE;
+		case 'C':
+			if (is_event_prefix(packet, size, EK_Charging)) {
+				return GODICE_EVENT_CHARGING;
+			}
+			return is_event_prefix(packet, size, EK_Color) ? GODICE_EVENT_COLOR : GODICE_EVENT_NONE;
+		default:
+			return GODICE_EVENT_NONE;
 	}
-	if (is_event_prefix(packet, size, EK_DoubleTap)) {
-		return GODICE_OK;
+}
+
+static godice_status_t incoming_packet(const godice_callbacks_t *cb, void *cb_userdata,
+									   godice_dice_state_t *state,
+									   int dice_id, int dice_max, const uint8_t *packet, size_t size) {
+	if (cb == NULL) {
+		return GODICE_INVALID_CALLBACK;
 	}
-	if (is_event_prefix(packet, size, EK_Battery)) {
-		return incoming_battery_packet(cb, cb_userdata, dice_id, packet + sizeof(EK_Battery) - 1, size - sizeof(EK_Battery) + 1);
+	godice_event_t event = godice_packet_event(packet, size);
+	if (event == GODICE_EVENT_NONE) {
+		return GODICE_INVALID_PACKET;
 	}
-	if (is_event_prefix(packet, size, EK_Charging)) {
-		return incoming_charging_packet(cb, cb_userdata, dice_id, packet + sizeof(EK_Charging) - 1, size - sizeof(EK_Charging) + 1);
+	if (cb->events_mask != 0 && (cb->events_mask & event) == 0) {
+		// Tracked state still follows rolls and stables, unsubscribed stables are not classified
+		// and leave no face to compare the next one with
+		if (state != NULL && event == GODICE_EVENT_ROLL) {
+			state->rolling = true;
+			state->stable = false;
+		} else if (state != NULL && (event & GODICE_EVENTS_STABLE_ALL) != 0) {
+			state->rolling = false;
+			state->stable = false;
+		}
+		return GODICE_NOT_SUBSCRIBED;
 	}
-	if (is_event_prefix(packet, size, EK_Stable)) {
-		return incoming_stable_packet(cb, cb_userdata,
-									  dice_id, dice_max,
-									  packet, size, NULL);
+	switch (event) {
+		case GODICE_EVENT_ROLL:
+			return incoming_roll_packet(cb, cb_userdata, state, dice_id, size);
+		case GODICE_EVENT_STABLE:
+			return incoming_stable_packet(cb, cb_userdata, state,
+										  dice_id, dice_max,
+										  packet, size, GODICE_STABLE);
+		case GODICE_EVENT_FAKE_STABLE:
+			return incoming_stable_packet(cb, cb_userdata, state,
+										  dice_id, dice_max,
+										  packet + 1, size - 1, GODICE_FAKE_STABLE);
+		case GODICE_EVENT_MOVE_STABLE:
+			return incoming_stable_packet(cb, cb_userdata, state,
+										  dice_id, dice_max,
+										  packet + 1, size - 1, GODICE_MOVE_STABLE);
+		case GODICE_EVENT_TILT_STABLE:
+			return incoming_stable_packet(cb, cb_userdata, state,
+										  dice_id, dice_max,
+										  packet + 1, size - 1, GODICE_TILT_STABLE);
+		case GODICE_EVENT_TAP:
+			return incoming_tap_packet(cb->on_dice_tap, cb_userdata, dice_id);
+		case GODICE_EVENT_DOUBLE_TAP:
+			return incoming_tap_packet(cb->on_dice_double_tap, cb_userdata, dice_id);
+		case GODICE_EVENT_BATTERY:
+			return incoming_battery_packet(cb, cb_userdata, dice_id, packet + sizeof(EK_Battery) - 1, size - sizeof(EK_Battery) + 1);
+		case GODICE_EVENT_CHARGING:
+			return incoming_charging_packet(cb, cb_userdata, dice_id, packet + sizeof(EK_Charging) - 1, size - sizeof(EK_Charging) + 1);
+		case GODICE_EVENT_COLOR:
+			return incoming_color_packet(cb, cb_userdata, dice_id, packet + sizeof(EK_Color) - 1, size - sizeof(EK_Color) + 1);
+		default:
+			return GODICE_INVALID_PACKET;
 	}
-	if (is_event_prefix(packet, size, EK_FakeStable) ||
-		is_event_prefix(packet, size, EK_TiltStable) ||
-		is_event_prefix(packet, size, EK_MoveStable)) {
+}
 
-		return incoming_stable_packet(cb, cb_userdata,
-									  dice_id, dice_max,
-									  packet + 1, size - 1, (char*)packet);
-	}
-	if (is_event_prefix(packet, size, EK_Color)) {
-		return incoming_color_packet(cb, cb_userdata, dice_id, packet + sizeof(EK_Color) - 1, size - sizeof(EK_Color) + 1);
-	}
-	return GODICE_INVALID_PACKET;
+godice_status_t godice_incoming_packet(const godice_callbacks_t *cb, void *cb_userdata,
+									   int dice_id, int dice_max, const uint8_t *packet, size_t size) {
+	return incoming_packet(cb, cb_userdata, NULL, dice_id, dice_max, packet, size);
+}
+
+void godice_dice_state_reset(godice_dice_state_t *state) {
+	state->rolling = false;
+	state->stable = false;
+	state->number = 0;
+	state->kind = GODICE_STABLE;
+	state->calibration = NULL;
+}
+
+godice_status_t godice_incoming_packet_tracked(const godice_callbacks_t *cb, void *cb_userdata,
+											   godice_dice_state_t *state,
+											   int dice_id, int dice_max,
+											   const uint8_t *packet, size_t size) {
+	return incoming_packet(cb, cb_userdata, state, dice_id, dice_max, packet, size);
 }
 
 godice_status_t godice_init_packet(uint8_t *buffer, size_t buffer_size, size_t *written_size,
@@ -4,6 +4,7 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include <stddef.h>
+#include "godiceconfig.h"
 
 #ifdef __OBJC__
 
@@ -30,6 +31,23 @@
 #define GODICE_MOVEMENT_DEG_DEFAULT (uint8_t)50
 #define GODICE_ROLL_THRESHOLD_DEFAULT (uint8_t)30
 
+// Maximum number of distinct values a dice type can report
+#define GODICE_MAX_DICE_VALUES 24
+// Maximum number of face vectors of a dice type
+#define GODICE_MAX_DICE_FACES 24
+// Largest `dice_max` value usable as dice type id
+#define GODICE_DICE_TYPE_ID_MAX 255
+#define GODICE_DICE_TYPE_NAME_SIZE 16
+
+// Calibrated face centroids are kept in 1/GODICE_CALIBRATION_SCALE axis units
+#define GODICE_CALIBRATION_SCALE 16
+// Number of samples after which centroids follow an exponential moving average
+#define GODICE_CALIBRATION_WINDOW 64
+// Readings closer than this (squared axis units) to another value's face are not learned from
+#define GODICE_CALIBRATION_MIN_MARGIN_SQ 1024
+#define GODICE_CALIBRATION_EXPORT_VERSION 1
+#define GODICE_CALIBRATION_EXPORT_SIZE(faces_num) (3 + (size_t)(faces_num) * 8)
+
 #define GODICE_INIT_PACKET_SIZE 10
 #define GODICE_OPEN_LEDS_PACKET_SIZE 7
 #define GODICE_TOGGLE_LEDS_PACKET_SIZE 9
@@ -47,6 +65,11 @@ GODICE_ENUM_BEGIN(godice_status_t)
 	GODICE_INVALID_PACKET = 1,
 	GODICE_BUFFER_TOO_SMALL = 2,
 	GODICE_INVALID_CALLBACK = 3,
+	GODICE_INVALID_ARGUMENT = 4,
+	GODICE_LIMIT_REACHED = 5,
+	GODICE_NOT_SUBSCRIBED = 6,
+	GODICE_IO_ERROR = 7,
+	GODICE_BUSY = 8,
 GODICE_ENUM_END(godice_status_t)
 
 GODICE_ENUM_BEGIN(godice_blink_mode_t)
@@ -69,14 +92,83 @@ GODICE_ENUM_BEGIN(godice_color_t)
 	GODICE_ORANGE = 5,
 GODICE_ENUM_END(godice_color_t)
 
+GODICE_ENUM_BEGIN(godice_stable_kind_t)
+	GODICE_STABLE = 0,
+	GODICE_FAKE_STABLE = 1,
+	GODICE_MOVE_STABLE = 2,
+	GODICE_TILT_STABLE = 3,
+GODICE_ENUM_END(godice_stable_kind_t)
+
+GODICE_ENUM_BEGIN(godice_event_t)
+	GODICE_EVENT_NONE = 0,
+	GODICE_EVENT_ROLL = 1 << 0,
+	GODICE_EVENT_STABLE = 1 << 1,
+	GODICE_EVENT_FAKE_STABLE = 1 << 2,
+	GODICE_EVENT_MOVE_STABLE = 1 << 3,
+	GODICE_EVENT_TILT_STABLE = 1 << 4,
+	GODICE_EVENT_TAP = 1 << 5,
+	GODICE_EVENT_DOUBLE_TAP = 1 << 6,
+	GODICE_EVENT_BATTERY = 1 << 7,
+	GODICE_EVENT_CHARGING = 1 << 8,
+	GODICE_EVENT_COLOR = 1 << 9,
+GODICE_ENUM_END(godice_event_t)
+
+#define GODICE_EVENTS_STABLE_ALL (GODICE_EVENT_STABLE | GODICE_EVENT_FAKE_STABLE | \
+								  GODICE_EVENT_MOVE_STABLE | GODICE_EVENT_TILT_STABLE)
+
+// Accelerometer reading of a dice lying on a face, as reported in stable packets
+typedef struct {
+	int8_t x, y, z;
+} godice_axis_t;
+
+typedef struct {
+	// Face index (1-based) nearest to the reading and the value it reports
+	uint8_t face;
+	uint8_t value;
+	// Squared distance from the reading to that face
+	int32_t distance_sq;
+	// Squared distance to the nearest face reporting a different value, minus `distance_sq`.
+	// Small margins mean the dice landed tilted between faces. `INT32_MAX` if there is no such face.
+	int32_t margin_sq;
+} godice_classification_t;
+
 typedef struct {
 	void (*on_dice_color)(void *userdata, int dice_id, godice_color_t color);
 	void (*on_dice_stable)(void *userdata, int dice_id, uint8_t number);
 	void (*on_charging_state_chaged)(void *userdata, int dice_id, bool charging);
 	void (*on_charge_level)(void *userdata, int dice_id, uint8_t level);
 	void (*on_dice_roll)(void *userdata, int dice_id);
+	void (*on_dice_stable_kind)(void *userdata, int dice_id, uint8_t number, godice_stable_kind_t kind);
+	void (*on_dice_tap)(void *userdata, int dice_id);
+	void (*on_dice_double_tap)(void *userdata, int dice_id);
+	// Combination of `godice_event_t` flags to decode, 0 decodes all events. Packets of other
+	// events are rejected with `GODICE_NOT_SUBSCRIBED` before they are validated or classified;
+	// tracked dice state still follows unsubscribed rolls and stables.
+	uint32_t events_mask;
 } godice_callbacks_t;
 
+// Face centroids learned from a single dice. Owned by the caller, one per dice.
+typedef struct {
+	int dice_max;
+	uint8_t faces_num;
+	// Update centroids from confident "S" packets
+	bool learning;
+	int16_t centroids[GODICE_MAX_DICE_FACES][3];
+	uint16_t samples[GODICE_MAX_DICE_FACES];
+} godice_calibration_t;
+
+// Per-dice roll/stable state used by `godice_incoming_packet_tracked`.
+// Owned by the caller, one per dice, reset with `godice_dice_state_reset` on (re)connect.
+typedef struct {
+	bool rolling;
+	bool stable;
+	uint8_t number;
+	godice_stable_kind_t kind;
+	// Optional, classifies stables using learned centroids instead of nominal faces
+	// when its `dice_max` matches. Cleared by `godice_dice_state_reset`.
+	godice_calibration_t *calibration;
+} godice_dice_state_t;
+
 typedef struct {
 	uint8_t number_of_blinks;
 	uint8_t light_on_duration_10ms;
@@ -91,6 +183,52 @@ typedef struct {
 godice_status_t godice_incoming_packet(const godice_callbacks_t *cb, void *cb_userdata,
 									   int dice_id, int dice_max, const uint8_t *packet, size_t size);
 
+// Registers a custom dice shell. `dice_max` becomes the type id passed to `godice_incoming_packet`
+// and must not be used by a built-in or previously registered type. `faces` holds the reading for
+// each face and `face_values` the value reported for it. Safe to call while other threads decode.
+godice_status_t godice_register_dice_type(int dice_max, const char *name,
+										  const godice_axis_t *faces, const uint8_t *face_values,
+										  size_t faces_num);
+const char *godice_dice_type_name(int dice_max);
+
+// Integer-only nearest face classification, same result as used for `on_dice_stable`
+godice_status_t godice_classify_axis(int dice_max, const godice_axis_t *axis,
+									 godice_classification_t *result);
+// Classifies a raw "S", "FS", "MS" or "TS" packet
+godice_status_t godice_classify_stable_packet(int dice_max, const uint8_t *packet, size_t size,
+											  godice_classification_t *result);
+
+// Starts calibration of a dice from nominal face readings of `dice_max` type
+godice_status_t godice_calibration_init(godice_calibration_t *calibration, int dice_max);
+// Classifies using learned centroids and learns from the reading if it is confident
+godice_status_t godice_calibration_classify_axis(godice_calibration_t *calibration,
+												 const godice_axis_t *axis,
+												 godice_classification_t *result);
+godice_status_t godice_calibration_export(const godice_calibration_t *calibration,
+										  uint8_t *buffer, size_t buffer_size, size_t *written_size);
+// Returns GODICE_INVALID_PACKET for buffers of other dice types or centroids out of axis range,
+// `calibration` is changed only on success
+godice_status_t godice_calibration_import(godice_calibration_t *calibration,
+										  const uint8_t *buffer, size_t size);
+
+// Writes distinct values that dice of type `dice_max` can report, in ascending order.
+// `values` should have room for `GODICE_MAX_DICE_VALUES` entries.
+godice_status_t godice_dice_values(int dice_max, uint8_t *values, size_t values_size, size_t *values_num);
+
+// Event carried by a raw packet, `GODICE_EVENT_NONE` if not recognized
+godice_event_t godice_packet_event(const uint8_t *packet, size_t size);
+
+void godice_dice_state_reset(godice_dice_state_t *state);
+
+// Same as `godice_incoming_packet`, but reports a stable event only when the face changed since
+// the last reported stable (or a roll happened in between) or when a "S" packet confirms a face
+// previously reported by "FS"/"MS"/"TS". Repeated roll packets are reported once per roll.
+// With `state` == NULL behaves exactly like `godice_incoming_packet`.
+godice_status_t godice_incoming_packet_tracked(const godice_callbacks_t *cb, void *cb_userdata,
+											   godice_dice_state_t *state,
+											   int dice_id, int dice_max,
+											   const uint8_t *packet, size_t size);
+
 godice_status_t godice_init_packet(uint8_t *buffer, size_t buffer_size, size_t *written_size,
 								   int dice_sensitivity, const godice_toggle_leds_t *toggle_leds);
 godice_status_t godice_open_leds_packet(uint8_t *buffer, size_t buffer_size, size_t *written_size,
@@ -0,0 +1,254 @@
+#include "godicebattery.h"
+#include <string.h>
+
+#define TICK_MASK (~(uint32_t)((1u << GODICE_BATTERY_TICK_SHIFT) - 1))
+#define LIST_DUE GODICE_BATTERY_WHEEL_SLOTS
+#define LIST_FREE 0xffff
+#define NONE 0xffff
+
+// Times are compared by difference, so they can wrap around
+static bool is_before_or_at(uint32_t time_ms, uint32_t limit_ms) {
+	return (int32_t)(time_ms - limit_ms) <= 0;
+}
+
+static void list_remove(godice_battery_t *battery, uint16_t index) {
+	godice_battery_dice_t *dice = &battery->dice[index];
+	if (dice->prev != NONE) {
+		battery->dice[dice->prev].next = dice->next;
+	} else {
+		battery->lists[dice->list] = dice->next;
+	}
+	if (dice->next != NONE) {
+		battery->dice[dice->next].prev = dice->prev;
+	}
+}
+
+static void list_add(godice_battery_t *battery, uint16_t index, uint16_t list) {
+	godice_battery_dice_t *dice = &battery->dice[index];
+	dice->list = list;
+	dice->prev = NONE;
+	dice->next = battery->lists[list];
+	if (dice->next != NONE) {
+		battery->dice[dice->next].prev = index;
+	}
+	battery->lists[list] = index;
+}
+
+// Puts a tracked dice, removed from its list, to the wheel slot of `due_ms` or to due polls
+static void schedule(godice_battery_t *battery, uint16_t index, uint32_t due_ms) {
+	battery->dice[index].due_ms = due_ms;
+	if (is_before_or_at(due_ms & TICK_MASK, battery->tick_ms)) {
+		list_add(battery, index, LIST_DUE);
+	} else {
+		list_add(battery, index, (uint16_t)((due_ms >> GODICE_BATTERY_TICK_SHIFT) & (GODICE_BATTERY_WHEEL_SLOTS - 1)));
+	}
+}
+
+// Moves polls due until `until_ms` from wheel slots of ticks after `from_ms` to due polls.
+// Slots hold polls of later wheel rounds too, which stay.
+static void collect(godice_battery_t *battery, uint32_t from_ms, uint32_t until_ms) {
+	if ((int32_t)(until_ms - from_ms) <= 0) {
+		return;
+	}
+	uint32_t ticks = (until_ms - from_ms) >> GODICE_BATTERY_TICK_SHIFT;
+	if (ticks > GODICE_BATTERY_WHEEL_SLOTS) {
+		ticks = GODICE_BATTERY_WHEEL_SLOTS;
+	}
+	uint32_t slot = from_ms >> GODICE_BATTERY_TICK_SHIFT;
+	for (uint32_t i = 0; i < ticks; i++) {
+		slot = (slot + 1) & (GODICE_BATTERY_WHEEL_SLOTS - 1);
+		uint16_t index = battery->lists[slot];
+		while (index != NONE) {
+			uint16_t next = battery->dice[index].next;
+			if (is_before_or_at(battery->dice[index].due_ms & TICK_MASK, until_ms)) {
+				list_remove(battery, index);
+				list_add(battery, index, LIST_DUE);
+			}
+			index = next;
+		}
+	}
+}
+
+void godice_battery_settings_default(godice_battery_settings_t *settings) {
+	settings->level_step = 10;
+	settings->min_interval_ms = 60 * 1000;
+	settings->max_interval_ms = 30 * 60 * 1000;
+	settings->quiet_ms = 3000;
+	settings->max_delay_ms = 60 * 1000;
+	settings->batch_ms = 30 * 1000;
+}
+
+void godice_battery_init(godice_battery_t *battery, const godice_battery_settings_t *settings, uint32_t now_ms) {
+	battery->settings = *settings;
+	if (battery->settings.level_step == 0) {
+		battery->settings.level_step = 1;
+	}
+	for (int i = 0; i < GODICE_BATTERY_DICE; i++) {
+		battery->dice[i].list = LIST_FREE;
+	}
+	for (int i = 0; i <= GODICE_BATTERY_WHEEL_SLOTS; i++) {
+		battery->lists[i] = NONE;
+	}
+	battery->tick_ms = now_ms & TICK_MASK;
+	battery->has_roll = false;
+	battery->roll_ms = 0;
+}
+
+static int find_dice(const godice_battery_t *battery, uint32_t dice_id) {
+	for (int i = 0; i < GODICE_BATTERY_DICE; i++) {
+		if (battery->dice[i].list != LIST_FREE && battery->dice[i].dice_id == dice_id) {
+			return i;
+		}
+	}
+	return -1;
+}
+
+static int add_dice(godice_battery_t *battery, uint32_t dice_id, uint32_t now_ms) {
+	int index = find_dice(battery, dice_id);
+	if (index >= 0) {
+		return index;
+	}
+	for (int i = 0; i < GODICE_BATTERY_DICE; i++) {
+		godice_battery_dice_t *dice = &battery->dice[i];
+		if (dice->list == LIST_FREE) {
+			memset(dice, 0, sizeof(*dice));
+			dice->dice_id = dice_id;
+			schedule(battery, (uint16_t)i, now_ms);
+			return i;
+		}
+	}
+	return -1;
+}
+
+godice_status_t godice_battery_add(godice_battery_t *battery, uint32_t dice_id, uint32_t now_ms) {
+	return add_dice(battery, dice_id, now_ms) >= 0 ? GODICE_OK : GODICE_LIMIT_REACHED;
+}
+
+void godice_battery_remove(godice_battery_t *battery, uint32_t dice_id) {
+	int index = find_dice(battery, dice_id);
+	if (index >= 0) {
+		list_remove(battery, (uint16_t)index);
+		battery->dice[index].list = LIST_FREE;
+	}
+}
+
+const godice_battery_dice_t *godice_battery_find(const godice_battery_t *battery, uint32_t dice_id) {
+	int index = find_dice(battery, dice_id);
+	return index >= 0 ? &battery->dice[index] : NULL;
+}
+
+// Time the level is predicted to cross the next step, within the poll interval bounds
+static uint32_t next_poll_ms(const godice_battery_t *battery, const godice_battery_dice_t *dice, uint32_t now_ms) {
+	const godice_battery_settings_t *settings = &battery->settings;
+	if (dice->charging || (dice->has_level && dice->level == 0)) {
+		return now_ms + settings->max_interval_ms;
+	}
+	if (!dice->has_level) {
+		return now_ms;
+	}
+	if (dice->ms_per_percent == 0) {
+		return now_ms + settings->min_interval_ms;
+	}
+	uint8_t threshold = (uint8_t)((dice->level - 1) / settings->level_step * settings->level_step);
+	int64_t delay = (int64_t)(int32_t)(dice->ref_time_ms - now_ms) +
+		(int64_t)(dice->ref_level - threshold) * dice->ms_per_percent;
+	if (delay < settings->min_interval_ms) {
+		delay = settings->min_interval_ms;
+	} else if (delay > settings->max_interval_ms) {
+		delay = settings->max_interval_ms;
+	}
+	return now_ms + (uint32_t)delay;
+}
+
+godice_status_t godice_battery_on_charge_level(godice_battery_t *battery, uint32_t dice_id, uint8_t level,
+											   uint32_t now_ms) {
+	int index = add_dice(battery, dice_id, now_ms);
+	if (index < 0) {
+		return GODICE_LIMIT_REACHED;
+	}
+	godice_battery_dice_t *dice = &battery->dice[index];
+	uint32_t elapsed_ms = now_ms - dice->ref_time_ms;
+	if (dice->charging || !dice->has_level || level > dice->ref_level) {
+		// Nothing to measure drain from
+		dice->ref_level = level;
+		dice->ref_time_ms = now_ms;
+	} else if (level < dice->ref_level) {
+		uint32_t sample = elapsed_ms / (dice->ref_level - level);
+		if (sample == 0) {
+			sample = 1;
+		}
+		// Moving average smooths levels reported in whole percents
+		dice->ms_per_percent = dice->ms_per_percent == 0 ? sample :
+			(uint32_t)(((uint64_t)dice->ms_per_percent * 3 + sample) / 4);
+		dice->ref_level = level;
+		dice->ref_time_ms = now_ms;
+	} else if (elapsed_ms > dice->ms_per_percent) {
+		// No percent drained yet, drain is at most this fast
+		dice->ms_per_percent = elapsed_ms;
+	}
+	dice->has_level = true;
+	dice->level = level;
+	list_remove(battery, (uint16_t)index);
+	schedule(battery, (uint16_t)index, next_poll_ms(battery, dice, now_ms));
+	return GODICE_OK;
+}
+
+godice_status_t godice_battery_on_charging(godice_battery_t *battery, uint32_t dice_id, bool charging,
+										   uint32_t now_ms) {
+	int index = add_dice(battery, dice_id, now_ms);
+	if (index < 0) {
+		return GODICE_LIMIT_REACHED;
+	}
+	godice_battery_dice_t *dice = &battery->dice[index];
+	if (dice->charging == charging) {
+		return GODICE_OK;
+	}
+	dice->charging = charging;
+	// Level after charging is unknown until polled, drain estimate is kept
+	dice->has_level = dice->has_level && charging;
+	list_remove(battery, (uint16_t)index);
+	schedule(battery, (uint16_t)index, next_poll_ms(battery, dice, now_ms));
+	return GODICE_OK;
+}
+
+void godice_battery_on_roll(godice_battery_t *battery, uint32_t now_ms) {
+	battery->has_roll = true;
+	battery->roll_ms = now_ms;
+}
+
+size_t godice_battery_poll(godice_battery_t *battery, uint32_t now_ms, uint32_t *dice_ids, size_t capacity) {
+	const godice_battery_settings_t *settings = &battery->settings;
+	uint32_t tick_ms = now_ms & TICK_MASK;
+	if ((int32_t)(tick_ms - battery->tick_ms) > 0) {
+		collect(battery, battery->tick_ms, tick_ms);
+		battery->tick_ms = tick_ms;
+	}
+	if (battery->lists[LIST_DUE] == NONE) {
+		return 0;
+	}
+
+	bool quiet = !battery->has_roll || now_ms - battery->roll_ms >= settings->quiet_ms;
+	if (!quiet) {
+		uint32_t oldest_ms = battery->dice[battery->lists[LIST_DUE]].due_ms;
+		for (uint16_t index = battery->lists[LIST_DUE]; index != NONE; index = battery->dice[index].next) {
+			if (!is_before_or_at(oldest_ms, battery->dice[index].due_ms)) {
+				oldest_ms = battery->dice[index].due_ms;
+			}
+		}
+		if ((int32_t)(now_ms - oldest_ms) < (int32_t)settings->max_delay_ms) {
+			return 0;
+		}
+	}
+
+	// Radio is used anyway, polls due soon are sent now
+	collect(battery, battery->tick_ms, (now_ms + settings->batch_ms) & TICK_MASK);
+	size_t count = 0;
+	while (count < capacity && battery->lists[LIST_DUE] != NONE) {
+		uint16_t index = battery->lists[LIST_DUE];
+		dice_ids[count++] = battery->dice[index].dice_id;
+		list_remove(battery, index);
+		// Retried if not answered
+		schedule(battery, index, now_ms + settings->min_interval_ms);
+	}
+	return count;
+}
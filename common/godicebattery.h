@@ -0,0 +1,87 @@
+#ifndef __GODICESDK_GODICEBATTERY_H
+#define __GODICESDK_GODICEBATTERY_H
+
+#include "godiceapi.h"
+
+// Timer wheel tick is 2^GODICE_BATTERY_TICK_SHIFT ms, polls may be sent up to one tick early
+#define GODICE_BATTERY_TICK_SHIFT 10
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+	// A poll is scheduled when the charge level is predicted to cross a multiple of `level_step`
+	uint8_t level_step;
+	// Bounds of the time between polls, `min_interval_ms` is also the retry of unanswered polls.
+	// Charging dice are polled every `max_interval_ms`.
+	uint32_t min_interval_ms;
+	uint32_t max_interval_ms;
+	// Due polls wait until no dice rolled for `quiet_ms`, but not longer than `max_delay_ms`
+	uint32_t quiet_ms;
+	uint32_t max_delay_ms;
+	// Polls due within `batch_ms` are sent together with due ones
+	uint32_t batch_ms;
+} godice_battery_settings_t;
+
+typedef struct {
+	uint32_t dice_id;
+	bool has_level;
+	uint8_t level;
+	bool charging;
+	// Drain estimate in ms per percent, 0 until the level is seen for a while
+	uint32_t ms_per_percent;
+	// Level drain is measured from and when it was first read
+	uint8_t ref_level;
+	uint32_t ref_time_ms;
+	uint32_t due_ms;
+
+	uint16_t list;
+	uint16_t next;
+	uint16_t prev;
+} godice_battery_dice_t;
+
+// Schedules charge level polls of many dice. Drain of every dice is estimated from successive
+// charge level readings, the next poll is planned for the time the level is predicted to cross a
+// step and kept in a hashed timer wheel. Due polls are held back while dice are rolling and sent
+// in batches between rolls. Owned by the caller, sized by GODICE_BATTERY_DICE and
+// GODICE_BATTERY_WHEEL_SLOTS, fields are private.
+typedef struct {
+	godice_battery_settings_t settings;
+	godice_battery_dice_t dice[GODICE_BATTERY_DICE];
+	// List heads of wheel slots followed by the list of due polls
+	uint16_t lists[GODICE_BATTERY_WHEEL_SLOTS + 1];
+	uint32_t tick_ms;
+	bool has_roll;
+	uint32_t roll_ms;
+} godice_battery_t;
+
+void godice_battery_settings_default(godice_battery_settings_t *settings);
+
+void godice_battery_init(godice_battery_t *battery, const godice_battery_settings_t *settings, uint32_t now_ms);
+
+// Starts tracking a connected dice, its first poll is due right away.
+// Returns GODICE_LIMIT_REACHED beyond GODICE_BATTERY_DICE dice.
+godice_status_t godice_battery_add(godice_battery_t *battery, uint32_t dice_id, uint32_t now_ms);
+void godice_battery_remove(godice_battery_t *battery, uint32_t dice_id);
+// Tracked dice or NULL
+const godice_battery_dice_t *godice_battery_find(const godice_battery_t *battery, uint32_t dice_id);
+
+// Feed from `on_charge_level`, `on_charging_state_chaged` and `on_roll` callbacks, unknown dice
+// are added
+godice_status_t godice_battery_on_charge_level(godice_battery_t *battery, uint32_t dice_id, uint8_t level,
+											   uint32_t now_ms);
+godice_status_t godice_battery_on_charging(godice_battery_t *battery, uint32_t dice_id, bool charging,
+										   uint32_t now_ms);
+void godice_battery_on_roll(godice_battery_t *battery, uint32_t now_ms);
+
+// Call periodically, at least once per tick while polls are due. Writes up to `capacity` dice to
+// send `godice_get_charge_level_packet` to and returns their number; polls beyond `capacity`
+// stay due.
+size_t godice_battery_poll(godice_battery_t *battery, uint32_t now_ms, uint32_t *dice_ids, size_t capacity);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __GODICESDK_GODICEBATTERY_H
@@ -0,0 +1,83 @@
+#ifndef __GODICESDK_GODICECONFIG_H
+#define __GODICESDK_GODICECONFIG_H
+
+// Compile-time configuration of the common library, every value can be overridden with a
+// compiler definition. The library never allocates memory: all state lives in caller-owned
+// structures sized by these values, which can be placed in static storage.
+//
+// GODICE_EMBEDDED selects the profile for microcontrollers: integer-only classification and
+// fixed point statistics (GODICE_STATS_SCALE), no floating point, no libm and smaller capacities.
+
+#ifdef GODICE_EMBEDDED
+#ifndef GODICE_INTEGER_ONLY
+#define GODICE_INTEGER_ONLY
+#endif
+#endif
+
+// Custom dice shells registered with `godice_register_dice_type`
+#ifndef GODICE_REGISTERED_DICE_TYPES_MAX
+#ifdef GODICE_EMBEDDED
+#define GODICE_REGISTERED_DICE_TYPES_MAX 2
+#else
+#define GODICE_REGISTERED_DICE_TYPES_MAX 16
+#endif
+#endif
+
+// Number of most recent rolls kept for sliding window statistics. Window alerts need
+// GODICE_STATS_MIN_EXPECTED rolls per value, so smaller windows never alert for the dice
+// with most values and are rejected by godicestats.h.
+#ifndef GODICE_STATS_WINDOW
+#define GODICE_STATS_WINDOW 120
+#endif
+
+// Maximal number of dice in a fleet snapshot
+#ifndef GODICE_FLEET_MAX_DICE
+#ifdef GODICE_EMBEDDED
+#define GODICE_FLEET_MAX_DICE 8
+#else
+#define GODICE_FLEET_MAX_DICE 64
+#endif
+#endif
+
+// Reads of a fleet snapshot retried while the decoder writes before giving up
+#ifndef GODICE_FLEET_SNAPSHOT_RETRIES
+#define GODICE_FLEET_SNAPSHOT_RETRIES 256
+#endif
+
+// Dice slots of a `godice_pool_t`
+#ifndef GODICE_POOL_DICE
+#ifdef GODICE_EMBEDDED
+#define GODICE_POOL_DICE 8
+#else
+#define GODICE_POOL_DICE 64
+#endif
+#endif
+
+// Outgoing packets queued in a `godice_pool_t`
+#ifndef GODICE_POOL_COMMANDS
+#ifdef GODICE_EMBEDDED
+#define GODICE_POOL_COMMANDS 16
+#else
+#define GODICE_POOL_COMMANDS 128
+#endif
+#endif
+
+// Dice tracked by a `godice_battery_t` poll scheduler
+#ifndef GODICE_BATTERY_DICE
+#ifdef GODICE_EMBEDDED
+#define GODICE_BATTERY_DICE 8
+#else
+#define GODICE_BATTERY_DICE 64
+#endif
+#endif
+
+// Timer wheel slots of a `godice_battery_t`, a power of two
+#ifndef GODICE_BATTERY_WHEEL_SLOTS
+#ifdef GODICE_EMBEDDED
+#define GODICE_BATTERY_WHEEL_SLOTS 16
+#else
+#define GODICE_BATTERY_WHEEL_SLOTS 64
+#endif
+#endif
+
+#endif // __GODICESDK_GODICECONFIG_H
@@ -0,0 +1,296 @@
+#include "godicefleet.h"
+#include <string.h>
+
+// Packed dice state layout
+#define STATE_VALUE_SHIFT 0
+#define STATE_FLAGS_SHIFT 8
+#define STATE_KIND_SHIFT 16
+#define STATE_CHARGE_LEVEL_SHIFT 24
+#define STATE_COLOR_SHIFT 32
+#define STATE_DICE_MAX_SHIFT 40
+
+#define STATE_ROLLING (1u << 0)
+#define STATE_STABLE (1u << 1)
+#define STATE_CHARGING (1u << 2)
+#define STATE_HAS_CHARGE_LEVEL (1u << 3)
+#define STATE_HAS_COLOR (1u << 4)
+
+static uint8_t state_field(uint64_t state, int shift) {
+	return (uint8_t)(state >> shift);
+}
+
+static uint64_t with_state_field(uint64_t state, int shift, uint8_t value) {
+	return (state & ~((uint64_t)0xff << shift)) | ((uint64_t)value << shift);
+}
+
+static uint64_t with_state_flags(uint64_t state, uint8_t set, uint8_t clear) {
+	uint8_t flags = state_field(state, STATE_FLAGS_SHIFT);
+	return with_state_field(state, STATE_FLAGS_SHIFT, (uint8_t)((flags & ~clear) | set));
+}
+
+static void store_state(godice_fleet_t *fleet, uint32_t slot, uint64_t state) {
+	atomic_store_explicit(&fleet->states_low[slot], (uint32_t)state, memory_order_relaxed);
+	atomic_store_explicit(&fleet->states_high[slot], (uint32_t)(state >> 32), memory_order_relaxed);
+}
+
+static uint64_t load_state(const godice_fleet_t *fleet, size_t slot) {
+	return atomic_load_explicit(&fleet->states_low[slot], memory_order_relaxed) |
+		(uint64_t)atomic_load_explicit(&fleet->states_high[slot], memory_order_relaxed) << 32;
+}
+
+// Sequence is odd while the decoder writes, it is made odd only once something changes
+// so that packets without effect don't disturb readers
+static void begin_write(godice_fleet_t *fleet) {
+	uint32_t sequence = atomic_load_explicit(&fleet->sequence, memory_order_relaxed);
+	if ((sequence & 1) == 0) {
+		atomic_store_explicit(&fleet->sequence, sequence + 1, memory_order_relaxed);
+		atomic_thread_fence(memory_order_release);
+	}
+}
+
+static void write_state(godice_fleet_t *fleet, uint32_t slot, uint64_t state) {
+	if (fleet->written[slot] == state) {
+		return;
+	}
+	begin_write(fleet);
+	fleet->written[slot] = state;
+	store_state(fleet, slot, state);
+}
+
+static void publish(godice_fleet_t *fleet) {
+	uint32_t sequence = atomic_load_explicit(&fleet->sequence, memory_order_relaxed);
+	if (sequence & 1) {
+		atomic_store_explicit(&fleet->sequence, sequence + 1, memory_order_release);
+	}
+}
+
+static bool is_forwarded(const godice_fleet_t *fleet, uint32_t event) {
+	return fleet->forward != NULL && (fleet->forward->events_mask == 0 || (fleet->forward->events_mask & event) != 0);
+}
+
+static void on_dice_color(void *userdata, int dice_id, godice_color_t color) {
+	godice_fleet_t *fleet = userdata;
+	uint64_t state = with_state_field(fleet->written[fleet->forward_slot], STATE_COLOR_SHIFT, (uint8_t)color);
+	write_state(fleet, fleet->forward_slot, with_state_flags(state, STATE_HAS_COLOR, 0));
+	if (is_forwarded(fleet, GODICE_EVENT_COLOR) && fleet->forward->on_dice_color != NULL) {
+		fleet->forward->on_dice_color(fleet->forward_userdata, dice_id, color);
+	}
+}
+
+static void on_dice_stable_kind(void *userdata, int dice_id, uint8_t number, godice_stable_kind_t kind) {
+	godice_fleet_t *fleet = userdata;
+	uint64_t state = fleet->written[fleet->forward_slot];
+	state = with_state_field(state, STATE_VALUE_SHIFT, number);
+	state = with_state_field(state, STATE_KIND_SHIFT, (uint8_t)kind);
+	write_state(fleet, fleet->forward_slot, with_state_flags(state, STATE_STABLE, STATE_ROLLING));
+	if (!is_forwarded(fleet, (uint32_t)GODICE_EVENT_STABLE << kind)) {
+		return;
+	}
+	if (fleet->forward->on_dice_stable != NULL) {
+		fleet->forward->on_dice_stable(fleet->forward_userdata, dice_id, number);
+	}
+	if (fleet->forward->on_dice_stable_kind != NULL) {
+		fleet->forward->on_dice_stable_kind(fleet->forward_userdata, dice_id, number, kind);
+	}
+}
+
+static void on_charging_state_changed(void *userdata, int dice_id, bool charging) {
+	godice_fleet_t *fleet = userdata;
+	uint64_t state = fleet->written[fleet->forward_slot];
+	write_state(fleet, fleet->forward_slot, with_state_flags(state, charging ? STATE_CHARGING : 0, charging ? 0 : STATE_CHARGING));
+	if (is_forwarded(fleet, GODICE_EVENT_CHARGING) && fleet->forward->on_charging_state_chaged != NULL) {
+		fleet->forward->on_charging_state_chaged(fleet->forward_userdata, dice_id, charging);
+	}
+}
+
+static void on_charge_level(void *userdata, int dice_id, uint8_t level) {
+	godice_fleet_t *fleet = userdata;
+	uint64_t state = with_state_field(fleet->written[fleet->forward_slot], STATE_CHARGE_LEVEL_SHIFT, level);
+	write_state(fleet, fleet->forward_slot, with_state_flags(state, STATE_HAS_CHARGE_LEVEL, 0));
+	if (is_forwarded(fleet, GODICE_EVENT_BATTERY) && fleet->forward->on_charge_level != NULL) {
+		fleet->forward->on_charge_level(fleet->forward_userdata, dice_id, level);
+	}
+}
+
+static void on_dice_roll(void *userdata, int dice_id) {
+	godice_fleet_t *fleet = userdata;
+	write_state(fleet, fleet->forward_slot, with_state_flags(fleet->written[fleet->forward_slot], STATE_ROLLING, 0));
+	if (is_forwarded(fleet, GODICE_EVENT_ROLL) && fleet->forward->on_dice_roll != NULL) {
+		fleet->forward->on_dice_roll(fleet->forward_userdata, dice_id);
+	}
+}
+
+static void on_dice_tap(void *userdata, int dice_id) {
+	godice_fleet_t *fleet = userdata;
+	if (is_forwarded(fleet, GODICE_EVENT_TAP) && fleet->forward->on_dice_tap != NULL) {
+		fleet->forward->on_dice_tap(fleet->forward_userdata, dice_id);
+	}
+}
+
+static void on_dice_double_tap(void *userdata, int dice_id) {
+	godice_fleet_t *fleet = userdata;
+	if (is_forwarded(fleet, GODICE_EVENT_DOUBLE_TAP) && fleet->forward->on_dice_double_tap != NULL) {
+		fleet->forward->on_dice_double_tap(fleet->forward_userdata, dice_id);
+	}
+}
+
+static const godice_callbacks_t FleetCallbacks = {
+	.on_dice_color = on_dice_color,
+	.on_charging_state_chaged = on_charging_state_changed,
+	.on_charge_level = on_charge_level,
+	.on_dice_roll = on_dice_roll,
+	.on_dice_stable_kind = on_dice_stable_kind,
+	.on_dice_tap = on_dice_tap,
+	.on_dice_double_tap = on_dice_double_tap,
+	.events_mask = 0,
+};
+
+void godice_fleet_init(godice_fleet_t *fleet) {
+	atomic_init(&fleet->sequence, 0);
+	atomic_init(&fleet->count, 0);
+	for (int i = 0; i < GODICE_FLEET_MAX_DICE; i++) {
+		atomic_init(&fleet->dice_ids[i], 0);
+		atomic_init(&fleet->states_low[i], 0);
+		atomic_init(&fleet->states_high[i], 0);
+		fleet->written[i] = 0;
+		godice_dice_state_reset(&fleet->dice_states[i]);
+	}
+	fleet->batch_depth = 0;
+	fleet->forward = NULL;
+	fleet->forward_userdata = NULL;
+	fleet->forward_slot = 0;
+}
+
+static int find_slot(const godice_fleet_t *fleet, uint32_t dice_id) {
+	uint32_t count = atomic_load_explicit(&fleet->count, memory_order_relaxed);
+	for (uint32_t i = 0; i < count; i++) {
+		if (atomic_load_explicit(&fleet->dice_ids[i], memory_order_relaxed) == dice_id) {
+			return (int)i;
+		}
+	}
+	return -1;
+}
+
+void godice_fleet_begin_update(godice_fleet_t *fleet) {
+	fleet->batch_depth++;
+}
+
+void godice_fleet_end_update(godice_fleet_t *fleet) {
+	if (fleet->batch_depth > 0 && --fleet->batch_depth == 0) {
+		publish(fleet);
+	}
+}
+
+godice_status_t godice_fleet_incoming_packet(godice_fleet_t *fleet, const godice_callbacks_t *cb, void *cb_userdata,
+											 uint32_t dice_id, int dice_max, const uint8_t *packet, size_t size) {
+	int slot = find_slot(fleet, dice_id);
+	godice_fleet_begin_update(fleet);
+	if (slot < 0) {
+		uint32_t count = atomic_load_explicit(&fleet->count, memory_order_relaxed);
+		if (count == GODICE_FLEET_MAX_DICE) {
+			godice_fleet_end_update(fleet);
+			return GODICE_LIMIT_REACHED;
+		}
+		slot = (int)count;
+		// Written while sequence is odd, readers never see a half added dice
+		uint64_t state = with_state_field(0, STATE_DICE_MAX_SHIFT, (uint8_t)dice_max);
+		begin_write(fleet);
+		fleet->written[slot] = state;
+		store_state(fleet, slot, state);
+		atomic_store_explicit(&fleet->dice_ids[slot], dice_id, memory_order_relaxed);
+		atomic_store_explicit(&fleet->count, count + 1, memory_order_relaxed);
+		godice_dice_state_reset(&fleet->dice_states[slot]);
+	} else if (state_field(fleet->written[slot], STATE_DICE_MAX_SHIFT) != (uint8_t)dice_max) {
+		write_state(fleet, (uint32_t)slot, with_state_field(fleet->written[slot], STATE_DICE_MAX_SHIFT, (uint8_t)dice_max));
+	}
+
+	fleet->forward = cb;
+	fleet->forward_userdata = cb_userdata;
+	fleet->forward_slot = (uint32_t)slot;
+	godice_status_t status = godice_incoming_packet_tracked(&FleetCallbacks, fleet, &fleet->dice_states[slot],
+															(int)dice_id, dice_max, packet, size);
+	fleet->forward = NULL;
+	godice_fleet_end_update(fleet);
+	return status;
+}
+
+void godice_fleet_reset_dice(godice_fleet_t *fleet, uint32_t dice_id) {
+	int slot = find_slot(fleet, dice_id);
+	if (slot < 0) {
+		return;
+	}
+	godice_fleet_begin_update(fleet);
+	godice_dice_state_reset(&fleet->dice_states[slot]);
+	uint8_t dice_max = state_field(fleet->written[slot], STATE_DICE_MAX_SHIFT);
+	write_state(fleet, (uint32_t)slot, with_state_field(0, STATE_DICE_MAX_SHIFT, dice_max));
+	godice_fleet_end_update(fleet);
+}
+
+void godice_fleet_remove_dice(godice_fleet_t *fleet, uint32_t dice_id) {
+	int slot = find_slot(fleet, dice_id);
+	if (slot < 0) {
+		return;
+	}
+	uint32_t last = atomic_load_explicit(&fleet->count, memory_order_relaxed) - 1;
+	godice_fleet_begin_update(fleet);
+	begin_write(fleet);
+	if ((uint32_t)slot != last) {
+		fleet->written[slot] = fleet->written[last];
+		fleet->dice_states[slot] = fleet->dice_states[last];
+		store_state(fleet, (uint32_t)slot, fleet->written[last]);
+		atomic_store_explicit(&fleet->dice_ids[slot],
+							  atomic_load_explicit(&fleet->dice_ids[last], memory_order_relaxed), memory_order_relaxed);
+	}
+	atomic_store_explicit(&fleet->count, last, memory_order_relaxed);
+	godice_fleet_end_update(fleet);
+}
+
+godice_status_t godice_fleet_snapshot(const godice_fleet_t *fleet, godice_fleet_dice_t *dice, size_t capacity,
+									  size_t *count, uint32_t *version) {
+	uint32_t dice_ids[GODICE_FLEET_MAX_DICE];
+	uint64_t states[GODICE_FLEET_MAX_DICE];
+	uint32_t begin;
+	size_t copied;
+	for (int retries = 0; ; retries++) {
+		if (retries == GODICE_FLEET_SNAPSHOT_RETRIES) {
+			return GODICE_BUSY;
+		}
+		begin = atomic_load_explicit(&fleet->sequence, memory_order_acquire);
+		if (begin & 1) {
+			continue;
+		}
+		copied = atomic_load_explicit(&fleet->count, memory_order_relaxed);
+		if (copied > capacity) {
+			copied = capacity;
+		}
+		for (size_t i = 0; i < copied; i++) {
+			dice_ids[i] = atomic_load_explicit(&fleet->dice_ids[i], memory_order_relaxed);
+			states[i] = load_state(fleet, i);
+		}
+		atomic_thread_fence(memory_order_acquire);
+		if (atomic_load_explicit(&fleet->sequence, memory_order_relaxed) == begin) {
+			break;
+		}
+	}
+
+	for (size_t i = 0; i < copied; i++) {
+		uint64_t state = states[i];
+		uint8_t flags = state_field(state, STATE_FLAGS_SHIFT);
+		dice[i].dice_id = dice_ids[i];
+		dice[i].dice_max = state_field(state, STATE_DICE_MAX_SHIFT);
+		dice[i].rolling = (flags & STATE_ROLLING) != 0;
+		dice[i].stable = (flags & STATE_STABLE) != 0;
+		dice[i].value = state_field(state, STATE_VALUE_SHIFT);
+		dice[i].kind = (godice_stable_kind_t)state_field(state, STATE_KIND_SHIFT);
+		dice[i].has_charge_level = (flags & STATE_HAS_CHARGE_LEVEL) != 0;
+		dice[i].charge_level = state_field(state, STATE_CHARGE_LEVEL_SHIFT);
+		dice[i].charging = (flags & STATE_CHARGING) != 0;
+		dice[i].has_color = (flags & STATE_HAS_COLOR) != 0;
+		dice[i].color = (godice_color_t)state_field(state, STATE_COLOR_SHIFT);
+	}
+	*count = copied;
+	if (version != NULL) {
+		*version = begin / 2;
+	}
+	return GODICE_OK;
+}
@@ -0,0 +1,79 @@
+#ifndef __GODICESDK_GODICEFLEET_H
+#define __GODICESDK_GODICEFLEET_H
+
+#include "godiceapi.h"
+
+#ifdef __cplusplus
+#include <atomic>
+#define GODICE_ATOMIC(TYPE) std::atomic<TYPE>
+extern "C" {
+#else
+#include <stdatomic.h>
+#define GODICE_ATOMIC(TYPE) _Atomic(TYPE)
+#endif
+
+// State of a single dice as seen by readers of a fleet
+typedef struct {
+	uint32_t dice_id;
+	uint8_t dice_max;
+	bool rolling;
+	// `value` and `kind` hold the last stable result
+	bool stable;
+	uint8_t value;
+	godice_stable_kind_t kind;
+	bool has_charge_level;
+	uint8_t charge_level;
+	bool charging;
+	bool has_color;
+	godice_color_t color;
+} godice_fleet_dice_t;
+
+// Current state of many dice, written by a single decoder thread and read by any number of
+// threads without locks. Readers copy all dice under a sequence counter (seqlock) and retry if
+// the decoder published an update meanwhile; the decoder never waits for readers.
+// Owned by the caller, initialize with `godice_fleet_init`, fields are private.
+typedef struct {
+	GODICE_ATOMIC(uint32_t) sequence;
+	GODICE_ATOMIC(uint32_t) count;
+	GODICE_ATOMIC(uint32_t) dice_ids[GODICE_FLEET_MAX_DICE];
+	// Packed `godice_fleet_dice_t` fields, split in 32-bit halves that are lock-free on
+	// 32-bit targets; the sequence counter keeps both halves consistent
+	GODICE_ATOMIC(uint32_t) states_low[GODICE_FLEET_MAX_DICE];
+	GODICE_ATOMIC(uint32_t) states_high[GODICE_FLEET_MAX_DICE];
+
+	// Decoder thread only
+	uint32_t batch_depth;
+	uint64_t written[GODICE_FLEET_MAX_DICE];
+	godice_dice_state_t dice_states[GODICE_FLEET_MAX_DICE];
+	const godice_callbacks_t *forward;
+	void *forward_userdata;
+	uint32_t forward_slot;
+} godice_fleet_t;
+
+void godice_fleet_init(godice_fleet_t *fleet);
+
+// Decoder thread: decodes like `godice_incoming_packet_tracked` with state kept in the fleet,
+// publishes the new state of the dice and forwards events to `cb` if it is not NULL.
+// Returns GODICE_LIMIT_REACHED for new dice beyond GODICE_FLEET_MAX_DICE.
+godice_status_t godice_fleet_incoming_packet(godice_fleet_t *fleet, const godice_callbacks_t *cb, void *cb_userdata,
+											 uint32_t dice_id, int dice_max, const uint8_t *packet, size_t size);
+// Decoder thread: updates between begin and end are published at once, e.g. per received buffer
+void godice_fleet_begin_update(godice_fleet_t *fleet);
+void godice_fleet_end_update(godice_fleet_t *fleet);
+// Decoder thread: resets tracked state and published values of a (re)connected dice
+void godice_fleet_reset_dice(godice_fleet_t *fleet, uint32_t dice_id);
+// Decoder thread: frees the slot of a disconnected dice, the last dice takes its place
+void godice_fleet_remove_dice(godice_fleet_t *fleet, uint32_t dice_id);
+
+// Any thread: copies a consistent state of up to `capacity` dice. `version` (optional) changes
+// with every published update, so unchanged fleets can be skipped. Returns GODICE_BUSY without
+// touching the outputs if the decoder stays in an update for GODICE_FLEET_SNAPSHOT_RETRIES
+// reads, e.g. preempted in the middle of a batch; keep showing the previous snapshot then.
+godice_status_t godice_fleet_snapshot(const godice_fleet_t *fleet, godice_fleet_dice_t *dice, size_t capacity,
+									  size_t *count, uint32_t *version);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __GODICESDK_GODICEFLEET_H
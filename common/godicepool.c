@@ -0,0 +1,92 @@
+#include "godicepool.h"
+#include <string.h>
+
+void godice_pool_init(godice_pool_t *pool) {
+	memset(pool->used, 0, sizeof(pool->used));
+	pool->commands_head = 0;
+	pool->commands_num = 0;
+}
+
+godice_pool_dice_t *godice_pool_find(godice_pool_t *pool, uint32_t dice_id) {
+	for (int i = 0; i < GODICE_POOL_DICE; i++) {
+		if (pool->used[i] && pool->dice[i].dice_id == dice_id) {
+			return &pool->dice[i];
+		}
+	}
+	return NULL;
+}
+
+static bool reset_dice(godice_pool_dice_t *dice, uint32_t dice_id, int dice_max) {
+	if (godice_calibration_init(&dice->calibration, dice_max) != GODICE_OK ||
+		godice_stats_init(&dice->stats, dice_max) != GODICE_OK) {
+		return false;
+	}
+	dice->dice_id = dice_id;
+	dice->dice_max = dice_max;
+	godice_dice_state_reset(&dice->state);
+	dice->state.calibration = &dice->calibration;
+	return true;
+}
+
+godice_pool_dice_t *godice_pool_dice(godice_pool_t *pool, uint32_t dice_id, int dice_max) {
+	godice_pool_dice_t *dice = godice_pool_find(pool, dice_id);
+	if (dice != NULL) {
+		if (dice->dice_max != dice_max && !reset_dice(dice, dice_id, dice_max)) {
+			godice_pool_release(pool, dice_id);
+			return NULL;
+		}
+		return dice;
+	}
+	for (int i = 0; i < GODICE_POOL_DICE; i++) {
+		if (!pool->used[i]) {
+			if (!reset_dice(&pool->dice[i], dice_id, dice_max)) {
+				return NULL;
+			}
+			pool->used[i] = true;
+			return &pool->dice[i];
+		}
+	}
+	return NULL;
+}
+
+void godice_pool_release(godice_pool_t *pool, uint32_t dice_id) {
+	godice_pool_dice_t *dice = godice_pool_find(pool, dice_id);
+	if (dice != NULL) {
+		pool->used[dice - pool->dice] = false;
+	}
+}
+
+godice_status_t godice_pool_incoming_packet(godice_pool_t *pool, const godice_callbacks_t *cb, void *cb_userdata,
+											uint32_t dice_id, int dice_max, const uint8_t *packet, size_t size) {
+	godice_pool_dice_t *dice = godice_pool_dice(pool, dice_id, dice_max);
+	if (dice == NULL) {
+		return GODICE_LIMIT_REACHED;
+	}
+	return godice_incoming_packet_tracked(cb, cb_userdata, &dice->state, (int)dice_id, dice_max, packet, size);
+}
+
+godice_status_t godice_pool_push_command(godice_pool_t *pool, uint32_t dice_id, const uint8_t *packet, size_t size) {
+	if (size > GODICE_POOL_MAX_PACKET_SIZE) {
+		return GODICE_BUFFER_TOO_SMALL;
+	}
+	if (pool->commands_num == GODICE_POOL_COMMANDS) {
+		return GODICE_LIMIT_REACHED;
+	}
+	godice_pool_command_t *command = &pool->commands[(pool->commands_head + pool->commands_num) % GODICE_POOL_COMMANDS];
+	command->dice_id = dice_id;
+	command->size = (uint8_t)size;
+	memcpy(command->packet, packet, size);
+	pool->commands_num++;
+	return GODICE_OK;
+}
+
+const godice_pool_command_t *godice_pool_peek_command(const godice_pool_t *pool) {
+	return pool->commands_num == 0 ? NULL : &pool->commands[pool->commands_head];
+}
+
+void godice_pool_pop_command(godice_pool_t *pool) {
+	if (pool->commands_num > 0) {
+		pool->commands_head = (uint16_t)((pool->commands_head + 1) % GODICE_POOL_COMMANDS);
+		pool->commands_num--;
+	}
+}
@@ -0,0 +1,64 @@
+#ifndef __GODICESDK_GODICEPOOL_H
+#define __GODICESDK_GODICEPOOL_H
+
+#include "godiceapi.h"
+#include "godicestats.h"
+
+// Largest packet built by the library
+#define GODICE_POOL_MAX_PACKET_SIZE GODICE_INIT_PACKET_SIZE
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Everything kept for a single dice
+typedef struct {
+	uint32_t dice_id;
+	int dice_max;
+	godice_dice_state_t state;
+	godice_calibration_t calibration;
+	godice_stats_t stats;
+} godice_pool_dice_t;
+
+typedef struct {
+	uint32_t dice_id;
+	uint8_t size;
+	uint8_t packet[GODICE_POOL_MAX_PACKET_SIZE];
+} godice_pool_command_t;
+
+// Fixed capacity storage for dice state and outgoing packets of a bridge, sized by
+// GODICE_POOL_DICE and GODICE_POOL_COMMANDS. Owned by the caller, usually a static variable.
+typedef struct {
+	bool used[GODICE_POOL_DICE];
+	godice_pool_dice_t dice[GODICE_POOL_DICE];
+	godice_pool_command_t commands[GODICE_POOL_COMMANDS];
+	uint16_t commands_head;
+	uint16_t commands_num;
+} godice_pool_t;
+
+void godice_pool_init(godice_pool_t *pool);
+
+// Returns dice slot, taking a free one with reset state, calibration and statistics for new
+// dice or a changed `dice_max`. Returns NULL if all slots are used or `dice_max` is unknown.
+godice_pool_dice_t *godice_pool_dice(godice_pool_t *pool, uint32_t dice_id, int dice_max);
+// Returns slot of a known dice or NULL
+godice_pool_dice_t *godice_pool_find(godice_pool_t *pool, uint32_t dice_id);
+// Frees the slot of a disconnected dice
+void godice_pool_release(godice_pool_t *pool, uint32_t dice_id);
+
+// Decodes like `godice_incoming_packet_tracked` using the dice slot with calibration.
+// Returns GODICE_LIMIT_REACHED if there is no slot for the dice.
+godice_status_t godice_pool_incoming_packet(godice_pool_t *pool, const godice_callbacks_t *cb, void *cb_userdata,
+											uint32_t dice_id, int dice_max, const uint8_t *packet, size_t size);
+
+// Queues a packet for `dice_id`, GODICE_LIMIT_REACHED if the queue is full
+godice_status_t godice_pool_push_command(godice_pool_t *pool, uint32_t dice_id, const uint8_t *packet, size_t size);
+// Oldest queued packet or NULL, stays queued until `godice_pool_pop_command`
+const godice_pool_command_t *godice_pool_peek_command(const godice_pool_t *pool);
+void godice_pool_pop_command(godice_pool_t *pool);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __GODICESDK_GODICEPOOL_H
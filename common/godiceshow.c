@@ -0,0 +1,255 @@
+#include "godiceshow.h"
+#include <string.h>
+
+#define SHOW_OPEN_DURATION UINT32_MAX
+#define SHOW_BLINK_UNIT_MS 10
+#define SHOW_MAX_BLINK_MS (UINT8_MAX * SHOW_BLINK_UNIT_MS)
+// GODICE_BLINKS_INFINITE is reserved
+#define SHOW_MAX_BLINKS (GODICE_BLINKS_INFINITE - 1)
+
+typedef struct {
+	uint32_t start_ms;
+	// SHOW_OPEN_DURATION for the last segment of tracks without end
+	uint32_t duration_ms;
+	godice_leds_colors_t colors;
+} segment_t;
+
+// Walks a track as segments of constant colors
+typedef struct {
+	const godice_show_track_t *track;
+	size_t keyframe;
+	bool ended;
+} segmentIterator_t;
+
+static const godice_leds_colors_t Black = { 0, 0, 0, 0, 0, 0 };
+
+static bool same_colors(const godice_leds_colors_t *a, const godice_leds_colors_t *b) {
+	return memcmp(a, b, sizeof(*a)) == 0;
+}
+
+static bool is_black(const godice_leds_colors_t *colors) {
+	return same_colors(colors, &Black);
+}
+
+static bool next_segment(segmentIterator_t *iterator, segment_t *segment) {
+	const godice_show_track_t *track = iterator->track;
+	if (iterator->keyframe < track->keyframes_num) {
+		const godice_keyframe_t *keyframe = &track->keyframes[iterator->keyframe];
+		segment->start_ms = keyframe->time_ms;
+		segment->colors = keyframe->colors;
+		do {
+			iterator->keyframe++;
+		} while (iterator->keyframe < track->keyframes_num &&
+				 same_colors(&track->keyframes[iterator->keyframe].colors, &segment->colors));
+		uint32_t end_ms = iterator->keyframe < track->keyframes_num
+			? track->keyframes[iterator->keyframe].time_ms
+			: track->end_ms;
+		segment->duration_ms = end_ms != 0 ? end_ms - segment->start_ms : SHOW_OPEN_DURATION;
+		return true;
+	}
+	if (track->end_ms != 0 && !iterator->ended) {
+		iterator->ended = true;
+		segment->start_ms = track->end_ms;
+		segment->duration_ms = SHOW_OPEN_DURATION;
+		segment->colors = Black;
+		return true;
+	}
+	return false;
+}
+
+static bool is_blink_duration(uint32_t duration_ms) {
+	return duration_ms >= SHOW_BLINK_UNIT_MS && duration_ms <= SHOW_MAX_BLINK_MS &&
+		duration_ms % SHOW_BLINK_UNIT_MS == 0;
+}
+
+// Single color toggle pattern shows one color on one or both LEDs
+static bool blink_leds(const godice_leds_colors_t *colors, godice_toggle_leds_t *toggle) {
+	const godice_leds_colors_t led1 = { colors->red1, colors->green1, colors->blue1,
+										colors->red1, colors->green1, colors->blue1 };
+	const godice_leds_colors_t led2 = { colors->red2, colors->green2, colors->blue2,
+										colors->red2, colors->green2, colors->blue2 };
+	if (is_black(colors)) {
+		return false;
+	}
+	if (same_colors(colors, &led1)) {
+		toggle->leds = GODICE_LEDS_BOTH;
+	} else if (colors->red2 == 0 && colors->green2 == 0 && colors->blue2 == 0) {
+		toggle->leds = GODICE_LED1;
+	} else if (colors->red1 == 0 && colors->green1 == 0 && colors->blue1 == 0) {
+		toggle->leds = GODICE_LED2;
+	} else {
+		return false;
+	}
+	const godice_leds_colors_t *source = toggle->leds == GODICE_LED2 ? &led2 : &led1;
+	toggle->color_red = source->red1;
+	toggle->color_green = source->green1;
+	toggle->color_blue = source->blue1;
+	toggle->blink_mode = GODICE_BLINK_PARALLEL;
+	return true;
+}
+
+// Matches blinks starting at `on`: `on` color and black segments of the same durations,
+// the last black may be longer. Advances `iterator` past the run.
+static bool match_blinks(segmentIterator_t *iterator, const segment_t *on, godice_toggle_leds_t *toggle) {
+	if (on->duration_ms == SHOW_OPEN_DURATION || !is_blink_duration(on->duration_ms) || !blink_leds(&on->colors, toggle)) {
+		return false;
+	}
+	segmentIterator_t lookahead = *iterator;
+	segment_t off;
+	if (!next_segment(&lookahead, &off) || !is_black(&off.colors)) {
+		return false;
+	}
+	// Single flash before staying dark
+	uint32_t off_ms = off.duration_ms == SHOW_OPEN_DURATION ? SHOW_BLINK_UNIT_MS : off.duration_ms;
+	if (off.duration_ms != SHOW_OPEN_DURATION && !is_blink_duration(off_ms)) {
+		return false;
+	}
+	uint8_t blinks = 1;
+	*iterator = lookahead;
+	while (off.duration_ms == off_ms && blinks < SHOW_MAX_BLINKS) {
+		segment_t next_on;
+		segment_t next_off;
+		if (!next_segment(&lookahead, &next_on) || !same_colors(&next_on.colors, &on->colors) ||
+			next_on.duration_ms != on->duration_ms ||
+			!next_segment(&lookahead, &next_off) || !is_black(&next_off.colors) || next_off.duration_ms < off_ms) {
+			break;
+		}
+		blinks++;
+		off = next_off;
+		*iterator = lookahead;
+	}
+	toggle->number_of_blinks = blinks;
+	toggle->light_on_duration_10ms = (uint8_t)(on->duration_ms / SHOW_BLINK_UNIT_MS);
+	toggle->light_off_duration_10ms = (uint8_t)(off_ms / SHOW_BLINK_UNIT_MS);
+	return true;
+}
+
+static godice_show_command_t *add_command(godice_show_command_t *commands, size_t capacity, size_t *commands_num,
+										  uint32_t time_ms, size_t track) {
+	if (*commands_num == capacity) {
+		return NULL;
+	}
+	godice_show_command_t *command = &commands[(*commands_num)++];
+	command->time_ms = time_ms;
+	command->track = (uint16_t)track;
+	return command;
+}
+
+static godice_status_t compile_track(const godice_show_track_t *tracks, size_t track,
+									 godice_show_command_t *commands, size_t capacity, size_t *commands_num) {
+	const godice_show_track_t *source = &tracks[track];
+	for (size_t i = 0; i < source->keyframes_num; i++) {
+		uint32_t time_ms = source->keyframes[i].time_ms;
+		if ((i > 0 && time_ms <= source->keyframes[i - 1].time_ms) || (source->end_ms != 0 && time_ms >= source->end_ms)) {
+			return GODICE_INVALID_ARGUMENT;
+		}
+	}
+
+	size_t first_command = *commands_num;
+	segmentIterator_t iterator = { source, 0, false };
+	bool known = false;
+	godice_leds_colors_t current = Black;
+	segment_t segment;
+	while (next_segment(&iterator, &segment)) {
+		godice_toggle_leds_t toggle;
+		bool blinking = match_blinks(&iterator, &segment, &toggle);
+		if (!blinking && known && same_colors(&segment.colors, &current)) {
+			continue;
+		}
+		godice_show_command_t *command = add_command(commands, capacity, commands_num, segment.start_ms, track);
+		if (command == NULL) {
+			return GODICE_BUFFER_TOO_SMALL;
+		}
+		size_t size;
+		const godice_leds_colors_t *colors = &segment.colors;
+		if (blinking) {
+			godice_toggle_leds_packet(command->packet, sizeof(command->packet), &size, &toggle);
+			// Blinks end dark
+			current = Black;
+		} else if (is_black(colors)) {
+			godice_close_toggle_leds_packet(command->packet, sizeof(command->packet), &size);
+			current = Black;
+		} else {
+			godice_open_leds_packet(command->packet, sizeof(command->packet), &size,
+									colors->red1, colors->green1, colors->blue1,
+									colors->red2, colors->green2, colors->blue2);
+			current = *colors;
+		}
+		command->size = (uint8_t)size;
+		known = true;
+	}
+
+	if (source->loop) {
+		// A loop must be a single blink pattern filling the whole track
+		godice_show_command_t *command = &commands[first_command];
+		if (source->end_ms == 0 || *commands_num != first_command + 1 || command->time_ms != 0 ||
+			command->size != GODICE_TOGGLE_LEDS_PACKET_SIZE ||
+			(uint32_t)command->packet[1] * (command->packet[2] + command->packet[3]) * SHOW_BLINK_UNIT_MS != source->end_ms) {
+			return GODICE_INVALID_ARGUMENT;
+		}
+		command->packet[1] = GODICE_BLINKS_INFINITE;
+	}
+	return GODICE_OK;
+}
+
+godice_status_t godice_show_compile(const godice_show_track_t *tracks, size_t tracks_num,
+									godice_show_command_t *commands, size_t capacity, size_t *commands_num) {
+	if (tracks_num > UINT16_MAX + 1) {
+		return GODICE_INVALID_ARGUMENT;
+	}
+	*commands_num = 0;
+	for (size_t track = 0; track < tracks_num; track++) {
+		godice_status_t status = compile_track(tracks, track, commands, capacity, commands_num);
+		if (status != GODICE_OK) {
+			return status;
+		}
+	}
+	// Stable insertion sort by time, shows have few commands and no heap is used
+	for (size_t i = 1; i < *commands_num; i++) {
+		godice_show_command_t command = commands[i];
+		size_t j = i;
+		while (j > 0 && commands[j - 1].time_ms > command.time_ms) {
+			commands[j] = commands[j - 1];
+			j--;
+		}
+		commands[j] = command;
+	}
+	return GODICE_OK;
+}
+
+void godice_show_player_init(godice_show_player_t *player, const godice_show_track_t *tracks,
+							 const godice_show_command_t *commands, size_t commands_num,
+							 uint64_t start_ms, uint32_t lead_ms) {
+	player->tracks = tracks;
+	player->commands = commands;
+	player->commands_num = commands_num;
+	player->start_ms = start_ms;
+	player->lead_ms = lead_ms;
+	player->next_command = 0;
+	player->next_dice = 0;
+}
+
+uint64_t godice_show_player_next_time(const godice_show_player_t *player) {
+	if (player->next_command >= player->commands_num) {
+		return UINT64_MAX;
+	}
+	uint64_t time_ms = player->start_ms + player->commands[player->next_command].time_ms;
+	return time_ms > player->lead_ms ? time_ms - player->lead_ms : 0;
+}
+
+godice_status_t godice_show_player_next(godice_show_player_t *player, uint64_t now_ms, uint32_t *dice_id,
+										const uint8_t **packet, size_t *size) {
+	while (godice_show_player_next_time(player) <= now_ms) {
+		const godice_show_command_t *command = &player->commands[player->next_command];
+		const godice_show_track_t *track = &player->tracks[command->track];
+		if (player->next_dice < track->dice_num) {
+			*dice_id = track->dice_ids[player->next_dice++];
+			*packet = command->packet;
+			*size = command->size;
+			return GODICE_OK;
+		}
+		player->next_command++;
+		player->next_dice = 0;
+	}
+	return GODICE_LIMIT_REACHED;
+}
@@ -0,0 +1,88 @@
+#ifndef __GODICESDK_GODICESHOW_H
+#define __GODICESDK_GODICESHOW_H
+
+#include "godiceapi.h"
+
+// LED shows: keyframed color timelines of dice groups compiled into LED packets.
+//
+// Every keyframe holds colors of both LEDs until the next keyframe. Runs of a color followed by
+// black are sent as a single `godice_toggle_leds_packet` blinking on the dice, other changes as
+// `godice_open_leds_packet` and black as `godice_close_toggle_leds_packet`. Blinks are timed in
+// 10 ms units up to 2550 ms, runs with other durations are sent as static colors. Fades are not
+// supported by dice and must be given as steps.
+
+#define GODICE_SHOW_MAX_PACKET_SIZE GODICE_TOGGLE_LEDS_PACKET_SIZE
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+	uint8_t red1;
+	uint8_t green1;
+	uint8_t blue1;
+	uint8_t red2;
+	uint8_t green2;
+	uint8_t blue2;
+} godice_leds_colors_t;
+
+typedef struct {
+	// Time from show start
+	uint32_t time_ms;
+	godice_leds_colors_t colors;
+} godice_keyframe_t;
+
+typedef struct {
+	// Dice showing this track, all get the same commands at the same time
+	const uint32_t *dice_ids;
+	size_t dice_num;
+	// Ordered by time
+	const godice_keyframe_t *keyframes;
+	size_t keyframes_num;
+	// LEDs are turned off at `end_ms` if not 0, otherwise the last keyframe stays on
+	uint32_t end_ms;
+	// Repeat until stopped, only tracks that blink a single pattern until `end_ms` can loop
+	bool loop;
+} godice_show_track_t;
+
+typedef struct {
+	uint32_t time_ms;
+	uint16_t track;
+	uint8_t size;
+	uint8_t packet[GODICE_SHOW_MAX_PACKET_SIZE];
+} godice_show_command_t;
+
+// Sends compiled commands to every dice of their track, `lead_ms` ahead of command time to
+// make up for radio latency. Owned by the caller.
+typedef struct {
+	const godice_show_track_t *tracks;
+	const godice_show_command_t *commands;
+	size_t commands_num;
+	uint64_t start_ms;
+	uint32_t lead_ms;
+	size_t next_command;
+	size_t next_dice;
+} godice_show_player_t;
+
+// Compiles tracks into commands ordered by time. Returns GODICE_BUFFER_TOO_SMALL if `capacity`
+// commands are not enough and GODICE_INVALID_ARGUMENT for unordered keyframes or tracks that
+// can't loop.
+godice_status_t godice_show_compile(const godice_show_track_t *tracks, size_t tracks_num,
+									godice_show_command_t *commands, size_t capacity, size_t *commands_num);
+
+// Starts playing compiled show at `start_ms`; choose it far enough ahead for the first
+// commands to reach all dice.
+void godice_show_player_init(godice_show_player_t *player, const godice_show_track_t *tracks,
+							 const godice_show_command_t *commands, size_t commands_num,
+							 uint64_t start_ms, uint32_t lead_ms);
+// Returns next packet due at `now_ms` and its dice, GODICE_LIMIT_REACHED if nothing is due
+godice_status_t godice_show_player_next(godice_show_player_t *player, uint64_t now_ms, uint32_t *dice_id,
+										const uint8_t **packet, size_t *size);
+// Time to send the next packet at, UINT64_MAX when the show is over
+uint64_t godice_show_player_next_time(const godice_show_player_t *player);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __GODICESDK_GODICESHOW_H
@@ -0,0 +1,172 @@
+#include "godicestats.h"
+#include <string.h>
+#ifndef GODICE_INTEGER_ONLY
+#include <math.h>
+
+static double c_log_c(uint32_t count) {
+	return count == 0 ? 0.0 : (double)count * log((double)count);
+}
+#else
+// Fixed point used inside critical value computation
+#define CRITICAL_SHIFT 16
+
+static uint64_t integer_square_root(uint64_t value) {
+	uint64_t root = 0;
+	for (uint64_t bit = (uint64_t)1 << 62; bit != 0; bit >>= 2) {
+		if (value >= root + bit) {
+			value -= root + bit;
+			root = (root >> 1) + bit;
+		} else {
+			root >>= 1;
+		}
+	}
+	return root;
+}
+#endif
+
+static int value_index(const godice_stats_t *stats, uint8_t value) {
+	int low = 0;
+	int high = stats->values_num - 1;
+	while (low <= high) {
+		int middle = (low + high) / 2;
+		if (stats->values[middle] == value) {
+			return middle;
+		}
+		if (stats->values[middle] < value) {
+			low = middle + 1;
+		} else {
+			high = middle - 1;
+		}
+	}
+	return -1;
+}
+
+static godice_stats_score_t chi_square(uint32_t total, uint64_t sum_squares, int values_num) {
+	if (total == 0) {
+		return 0;
+	}
+	// sum((c - E)^2 / E) == k / N * sum(c^2) - N
+#ifdef GODICE_INTEGER_ONLY
+	// Quotient and remainder are scaled separately, sum(c^2) * k * scale may not fit 64 bits
+	uint64_t quotient = sum_squares / total;
+	uint64_t remainder = sum_squares % total;
+	uint64_t scaled = quotient * (uint64_t)values_num * GODICE_STATS_SCALE +
+		remainder * (uint64_t)values_num * GODICE_STATS_SCALE / total;
+	return (godice_stats_score_t)scaled - (godice_stats_score_t)total * GODICE_STATS_SCALE;
+#else
+	return (double)values_num * (double)sum_squares / (double)total - (double)total;
+#endif
+}
+
+static bool is_drifting(godice_stats_score_t score, uint32_t total, int values_num, godice_stats_score_t z) {
+	if (total < (uint32_t)(GODICE_STATS_MIN_EXPECTED * values_num)) {
+		return false;
+	}
+	return score > godice_stats_critical_value(values_num - 1, z);
+}
+
+godice_status_t godice_stats_init(godice_stats_t *stats, int dice_max) {
+	size_t values_num;
+	godice_status_t status = godice_dice_values(dice_max, stats->values, sizeof(stats->values), &values_num);
+	if (status != GODICE_OK) {
+		return status;
+	}
+	stats->dice_max = dice_max;
+	stats->values_num = (uint8_t)values_num;
+	stats->alert_z = GODICE_STATS_Z_DEFAULT;
+	godice_stats_reset(stats);
+	return GODICE_OK;
+}
+
+void godice_stats_reset(godice_stats_t *stats) {
+	stats->total = 0;
+	memset(stats->counts, 0, sizeof(stats->counts));
+	stats->sum_squares = 0;
+#ifndef GODICE_INTEGER_ONLY
+	stats->sum_c_log_c = 0.0;
+#endif
+	stats->window_pos = 0;
+	stats->window_len = 0;
+	memset(stats->window_counts, 0, sizeof(stats->window_counts));
+	stats->window_sum_squares = 0;
+	stats->alerts = GODICE_STATS_ALERT_NONE;
+}
+
+godice_stats_alert_t godice_stats_add(godice_stats_t *stats, uint8_t value) {
+	int index = value_index(stats, value);
+	if (index < 0) {
+		return GODICE_STATS_ALERT_NONE;
+	}
+
+	uint32_t count = stats->counts[index];
+	stats->sum_squares += 2 * (uint64_t)count + 1;
+#ifndef GODICE_INTEGER_ONLY
+	stats->sum_c_log_c += c_log_c(count + 1) - c_log_c(count);
+#endif
+	stats->counts[index] = count + 1;
+	stats->total++;
+
+	if (stats->window_len == GODICE_STATS_WINDOW) {
+		uint8_t oldest = stats->window[stats->window_pos];
+		uint32_t oldest_count = stats->window_counts[oldest];
+		stats->window_sum_squares -= 2 * (uint64_t)oldest_count - 1;
+		stats->window_counts[oldest] = oldest_count - 1;
+	} else {
+		stats->window_len++;
+	}
+	uint32_t window_count = stats->window_counts[index];
+	stats->window_sum_squares += 2 * (uint64_t)window_count + 1;
+	stats->window_counts[index] = window_count + 1;
+	stats->window[stats->window_pos] = (uint8_t)index;
+	stats->window_pos = (uint16_t)((stats->window_pos + 1) % GODICE_STATS_WINDOW);
+
+	int alerts = GODICE_STATS_ALERT_NONE;
+	if (is_drifting(godice_stats_chi_square(stats), stats->total, stats->values_num, stats->alert_z)) {
+		alerts |= GODICE_STATS_ALERT_TOTAL;
+	}
+	if (is_drifting(godice_stats_window_chi_square(stats), stats->window_len, stats->values_num, stats->alert_z)) {
+		alerts |= GODICE_STATS_ALERT_WINDOW;
+	}
+	int raised = alerts & ~stats->alerts;
+	stats->alerts = alerts;
+	return (godice_stats_alert_t)raised;
+}
+
+godice_stats_score_t godice_stats_chi_square(const godice_stats_t *stats) {
+	return chi_square(stats->total, stats->sum_squares, stats->values_num);
+}
+
+godice_stats_score_t godice_stats_window_chi_square(const godice_stats_t *stats) {
+	return chi_square(stats->window_len, stats->window_sum_squares, stats->values_num);
+}
+
+#ifndef GODICE_INTEGER_ONLY
+double godice_stats_g_test(const godice_stats_t *stats) {
+	if (stats->total == 0) {
+		return 0.0;
+	}
+	// 2 * sum(c * ln(c / E)) with E == N / k
+	double total = (double)stats->total;
+	return 2.0 * (stats->sum_c_log_c - total * log(total / (double)stats->values_num));
+}
+#endif
+
+godice_stats_score_t godice_stats_critical_value(int dof, godice_stats_score_t z) {
+	if (dof <= 0) {
+		return 0;
+	}
+	// Wilson-Hilferty approximation
+#ifdef GODICE_INTEGER_ONLY
+	int64_t one = (int64_t)1 << CRITICAL_SHIFT;
+	int64_t a = (2 * one) / (9 * (int64_t)dof);
+	int64_t root = (int64_t)integer_square_root((uint64_t)a << CRITICAL_SHIFT);
+	int64_t z_fixed = z * (one / GODICE_STATS_SCALE);
+	int64_t term = one - a + ((z_fixed * root) >> CRITICAL_SHIFT);
+	int64_t cube = (((term * term) >> CRITICAL_SHIFT) * term) >> CRITICAL_SHIFT;
+	return (godice_stats_score_t)((dof * cube) / (one / GODICE_STATS_SCALE));
+#else
+	double k = (double)dof;
+	double term = 1.0 - 2.0 / (9.0 * k) + z * sqrt(2.0 / (9.0 * k));
+	return k * term * term * term;
+#endif
+}
@@ -0,0 +1,84 @@
+#ifndef __GODICESDK_GODICESTATS_H
+#define __GODICESDK_GODICESTATS_H
+
+#include "godiceapi.h"
+
+// Minimum expected count per value before chi-square results are considered meaningful
+#define GODICE_STATS_MIN_EXPECTED 5
+
+#if GODICE_STATS_WINDOW < GODICE_STATS_MIN_EXPECTED * GODICE_MAX_DICE_VALUES
+#error "GODICE_STATS_WINDOW is too small for window alerts of every dice type"
+#endif
+
+// Scores and quantiles are `double`, integer-only builds use fixed point with
+// GODICE_STATS_SCALE units per 1.0 so that no floating point code is linked
+#ifdef GODICE_INTEGER_ONLY
+#define GODICE_STATS_SCALE 256
+typedef int64_t godice_stats_score_t;
+#define GODICE_STATS_SCORE(value) ((godice_stats_score_t)((value) * GODICE_STATS_SCALE))
+#else
+typedef double godice_stats_score_t;
+#define GODICE_STATS_SCORE(value) ((godice_stats_score_t)(value))
+#endif
+
+// Standard normal quantile for alert threshold (3.09 ~ p < 0.001)
+#define GODICE_STATS_Z_DEFAULT GODICE_STATS_SCORE(3.09)
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+GODICE_ENUM_BEGIN(godice_stats_alert_t)
+	GODICE_STATS_ALERT_NONE = 0,
+	GODICE_STATS_ALERT_TOTAL = 1,
+	GODICE_STATS_ALERT_WINDOW = 2,
+GODICE_ENUM_END(godice_stats_alert_t)
+
+// Face frequency statistics for a single dice or for all dice of a single type.
+// Fixed size, owned by the caller. All updates are O(1).
+typedef struct {
+	int dice_max;
+	uint8_t values[GODICE_MAX_DICE_VALUES];
+	uint8_t values_num;
+
+	uint32_t total;
+	uint32_t counts[GODICE_MAX_DICE_VALUES];
+	uint64_t sum_squares;
+#ifndef GODICE_INTEGER_ONLY
+	double sum_c_log_c;
+#endif
+
+	uint8_t window[GODICE_STATS_WINDOW];
+	uint16_t window_pos;
+	uint16_t window_len;
+	uint32_t window_counts[GODICE_MAX_DICE_VALUES];
+	uint64_t window_sum_squares;
+
+	godice_stats_score_t alert_z;
+	int alerts;
+} godice_stats_t;
+
+godice_status_t godice_stats_init(godice_stats_t *stats, int dice_max);
+void godice_stats_reset(godice_stats_t *stats);
+
+// Adds a stable value as reported by `on_dice_stable`. Returns alerts raised by this roll:
+// an alert is raised once when a chi-square score crosses the threshold and is re-armed
+// after the score drops back below it.
+godice_stats_alert_t godice_stats_add(godice_stats_t *stats, uint8_t value);
+
+// Pearson chi-square score over all rolls (degrees of freedom: `values_num` - 1)
+godice_stats_score_t godice_stats_chi_square(const godice_stats_t *stats);
+// Pearson chi-square score over the last `GODICE_STATS_WINDOW` rolls
+godice_stats_score_t godice_stats_window_chi_square(const godice_stats_t *stats);
+#ifndef GODICE_INTEGER_ONLY
+// G-test (log-likelihood ratio) score over all rolls, needs libm
+double godice_stats_g_test(const godice_stats_t *stats);
+#endif
+// Approximate chi-square critical value for `dof` degrees of freedom and normal quantile `z`
+godice_stats_score_t godice_stats_critical_value(int dof, godice_stats_score_t z);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __GODICESDK_GODICESTATS_H
@@ -0,0 +1,178 @@
+#include "godicetuner.h"
+#include <stddef.h>
+
+#define countof(array) (sizeof(array) / sizeof(array[0]))
+
+typedef struct {
+	size_t offset;
+	uint8_t min;
+	uint8_t max;
+	uint8_t step;
+} tunableParam_t;
+
+// Parameters in the order they are searched, the ones affecting latency the most go first
+static const tunableParam_t TunableParams[] = {
+	{ offsetof(godice_detection_settings_t, samples_count), 1, 16, 1 },
+	{ offsetof(godice_detection_settings_t, movement_count), 1, 16, 1 },
+	{ offsetof(godice_detection_settings_t, face_count), 1, 16, 1 },
+	{ offsetof(godice_detection_settings_t, roll_threshold), 5, 100, 5 },
+	{ offsetof(godice_detection_settings_t, movement_deg), 10, 90, 5 },
+	{ offsetof(godice_detection_settings_t, weak_stable), 5, 100, 5 },
+	// Flat window, min_flat_deg is kept below max_flat_deg
+	{ offsetof(godice_detection_settings_t, max_flat_deg), 30, 80, 4 },
+	{ offsetof(godice_detection_settings_t, min_flat_deg), 2, 40, 2 },
+};
+
+static uint8_t param_get(const godice_detection_settings_t *settings, const tunableParam_t *param) {
+	return *((const uint8_t*)settings + param->offset);
+}
+
+static void param_set(godice_detection_settings_t *settings, const tunableParam_t *param, uint8_t value) {
+	*((uint8_t*)settings + param->offset) = value;
+}
+
+void godice_detection_settings_default(godice_detection_settings_t *settings) {
+	settings->samples_count = GODICE_SAMPLES_COUNT_DEFAULT;
+	settings->movement_count = GODICE_MOVEMENT_COUNT_DEFAULT;
+	settings->face_count = GODICE_FACE_COUNT_DEFAULT;
+	settings->min_flat_deg = GODICE_MIN_FLAT_DEG_DEFAULT;
+	settings->max_flat_deg = GODICE_MAX_FLAT_DEG_DEFAULT;
+	settings->weak_stable = GODICE_WEAK_STABLE_DEFAULT;
+	settings->movement_deg = GODICE_MOVEMENT_DEG_DEFAULT;
+	settings->roll_threshold = GODICE_ROLL_THRESHOLD_DEFAULT;
+}
+
+godice_status_t godice_detection_settings_packet(uint8_t *buffer, size_t buffer_size, size_t *written_size,
+												 const godice_detection_settings_t *settings) {
+	return godice_detection_settings_update_packet(buffer, buffer_size, written_size,
+												   settings->samples_count, settings->movement_count,
+												   settings->face_count, settings->min_flat_deg,
+												   settings->max_flat_deg, settings->weak_stable,
+												   settings->movement_deg, settings->roll_threshold);
+}
+
+void godice_tuner_init(godice_tuner_t *tuner, const godice_detection_settings_t *settings) {
+	tuner->settings = *settings;
+	tuner->best = *settings;
+	tuner->rolling = false;
+	tuner->roll_time_ms = 0;
+	tuner->trial_rolls = 0;
+	tuner->trial_bad = 0;
+	tuner->trial_latency_ms = 0;
+	tuner->has_best = false;
+	tuner->best_latency_ms = 0;
+	tuner->baseline_bad_percent = 0;
+	tuner->param = 0;
+	tuner->direction = -1;
+	tuner->rejected = 0;
+	tuner->converged = false;
+	tuner->update_pending = false;
+}
+
+void godice_tuner_on_roll(godice_tuner_t *tuner, uint32_t now_ms) {
+	if (!tuner->rolling) {
+		tuner->rolling = true;
+		tuner->roll_time_ms = now_ms;
+	}
+}
+
+static void advance_param(godice_tuner_t *tuner) {
+	if (tuner->direction < 0) {
+		tuner->direction = 1;
+	} else {
+		tuner->direction = -1;
+		tuner->param = (uint8_t)((tuner->param + 1) % countof(TunableParams));
+	}
+	tuner->rejected++;
+}
+
+// Prepares the next candidate derived from the best settings. Returns false when every
+// parameter has been tried in both directions since the last improvement.
+static bool next_candidate(godice_tuner_t *tuner) {
+	while (tuner->rejected < 2 * countof(TunableParams)) {
+		const tunableParam_t *param = &TunableParams[tuner->param];
+		int value = param_get(&tuner->best, param) + tuner->direction * param->step;
+		if (value >= param->min && value <= param->max) {
+			tuner->settings = tuner->best;
+			param_set(&tuner->settings, param, (uint8_t)value);
+			if (tuner->settings.min_flat_deg < tuner->settings.max_flat_deg) {
+				return true;
+			}
+		}
+		advance_param(tuner);
+	}
+	return false;
+}
+
+static bool same_settings(const godice_detection_settings_t *a, const godice_detection_settings_t *b) {
+	for (size_t i = 0; i < countof(TunableParams); i++) {
+		if (param_get(a, &TunableParams[i]) != param_get(b, &TunableParams[i])) {
+			return false;
+		}
+	}
+	return true;
+}
+
+bool godice_tuner_on_stable(godice_tuner_t *tuner, uint32_t now_ms, godice_stable_kind_t kind) {
+	if (!tuner->rolling) {
+		return false;
+	}
+	tuner->rolling = false;
+	uint32_t latency = now_ms - tuner->roll_time_ms;
+	if (tuner->converged || latency > GODICE_TUNER_MAX_LATENCY_MS) {
+		return false;
+	}
+	tuner->trial_rolls++;
+	tuner->trial_latency_ms += latency;
+	if (kind == GODICE_FAKE_STABLE || kind == GODICE_TILT_STABLE) {
+		tuner->trial_bad++;
+	}
+	if (tuner->trial_rolls < GODICE_TUNER_TRIAL_ROLLS) {
+		return false;
+	}
+
+	uint32_t average_latency = tuner->trial_latency_ms / tuner->trial_rolls;
+	uint16_t bad_percent = (uint16_t)(tuner->trial_bad * 100 / tuner->trial_rolls);
+	tuner->trial_rolls = 0;
+	tuner->trial_bad = 0;
+	tuner->trial_latency_ms = 0;
+
+	bool accepted = !tuner->has_best;
+	if (tuner->has_best) {
+		bool faster = average_latency * 100 <= tuner->best_latency_ms * (100 - GODICE_TUNER_MIN_GAIN_PERCENT);
+		bool reliable = bad_percent <= tuner->baseline_bad_percent + GODICE_TUNER_MAX_BAD_INCREASE_PERCENT;
+		accepted = faster && reliable;
+	}
+	if (accepted) {
+		if (!tuner->has_best) {
+			tuner->baseline_bad_percent = bad_percent;
+		}
+		// Keep pushing the same parameter in the same direction
+		tuner->has_best = true;
+		tuner->best = tuner->settings;
+		tuner->best_latency_ms = average_latency;
+		tuner->rejected = 0;
+	} else {
+		advance_param(tuner);
+	}
+
+	if (!next_candidate(tuner)) {
+		tuner->converged = true;
+		if (same_settings(&tuner->settings, &tuner->best)) {
+			return false;
+		}
+		tuner->settings = tuner->best;
+	}
+	tuner->update_pending = true;
+	return true;
+}
+
+godice_status_t godice_tuner_update_packet(godice_tuner_t *tuner,
+										   uint8_t *buffer, size_t buffer_size, size_t *written_size) {
+	godice_status_t status = godice_detection_settings_packet(buffer, buffer_size, written_size,
+															  &tuner->settings);
+	if (status == GODICE_OK) {
+		tuner->update_pending = false;
+	}
+	return status;
+}
@@ -0,0 +1,77 @@
+#ifndef __GODICESDK_GODICETUNER_H
+#define __GODICESDK_GODICETUNER_H
+
+#include "godiceapi.h"
+
+// Rolls observed per evaluated settings candidate
+#ifndef GODICE_TUNER_TRIAL_ROLLS
+#define GODICE_TUNER_TRIAL_ROLLS 20
+#endif
+// Minimal average roll-to-result improvement (percent) for a candidate to be kept
+#define GODICE_TUNER_MIN_GAIN_PERCENT 5
+// Allowed increase of fake/tilt stable rate (percent points) over the initial settings for a
+// candidate to be kept
+#define GODICE_TUNER_MAX_BAD_INCREASE_PERCENT 2
+// Roll-to-result times above this are treated as a lost result and ignored
+#define GODICE_TUNER_MAX_LATENCY_MS 10000
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+	uint8_t samples_count;
+	uint8_t movement_count;
+	uint8_t face_count;
+	uint8_t min_flat_deg;
+	uint8_t max_flat_deg;
+	uint8_t weak_stable;
+	uint8_t movement_deg;
+	uint8_t roll_threshold;
+} godice_detection_settings_t;
+
+// Searches detection settings of a single dice for shorter roll-to-result time without raising
+// the rate of fake and tilt stables. Owned by the caller, one per dice; reinitialize it when the
+// dice shell changes. Candidates differ from the best settings by one parameter step and are
+// evaluated over `GODICE_TUNER_TRIAL_ROLLS` rolls each. Every detection setting is searched,
+// candidates with `min_flat_deg` not below `max_flat_deg` are skipped.
+typedef struct {
+	godice_detection_settings_t settings;
+	godice_detection_settings_t best;
+
+	bool rolling;
+	uint32_t roll_time_ms;
+
+	uint16_t trial_rolls;
+	uint16_t trial_bad;
+	uint32_t trial_latency_ms;
+
+	bool has_best;
+	uint32_t best_latency_ms;
+	// Fake/tilt stable rate of the initial settings
+	uint16_t baseline_bad_percent;
+
+	uint8_t param;
+	int8_t direction;
+	uint8_t rejected;
+	bool converged;
+	bool update_pending;
+} godice_tuner_t;
+
+void godice_detection_settings_default(godice_detection_settings_t *settings);
+godice_status_t godice_detection_settings_packet(uint8_t *buffer, size_t buffer_size, size_t *written_size,
+												 const godice_detection_settings_t *settings);
+
+void godice_tuner_init(godice_tuner_t *tuner, const godice_detection_settings_t *settings);
+void godice_tuner_on_roll(godice_tuner_t *tuner, uint32_t now_ms);
+// Returns true when the tuner switched to new settings, which should be sent with
+// `godice_tuner_update_packet`
+bool godice_tuner_on_stable(godice_tuner_t *tuner, uint32_t now_ms, godice_stable_kind_t kind);
+godice_status_t godice_tuner_update_packet(godice_tuner_t *tuner,
+										   uint8_t *buffer, size_t buffer_size, size_t *written_size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __GODICESDK_GODICETUNER_H
@@ -0,0 +1,197 @@
+#include "godicewire.h"
+
+static const uint8_t WireMagic[] = { 'G', 'W' };
+
+static void write_le(uint8_t *buffer, uint64_t value, int bytes) {
+	for (int i = 0; i < bytes; i++) {
+		buffer[i] = (uint8_t)(value >> (8 * i));
+	}
+}
+
+static uint64_t read_le(const uint8_t *buffer, int bytes) {
+	uint64_t value = 0;
+	for (int i = 0; i < bytes; i++) {
+		value |= (uint64_t)buffer[i] << (8 * i);
+	}
+	return value;
+}
+
+static size_t write_varint(uint8_t *buffer, uint64_t value) {
+	size_t size = 0;
+	while (value >= 0x80) {
+		buffer[size++] = (uint8_t)(value | 0x80);
+		value >>= 7;
+	}
+	buffer[size++] = (uint8_t)value;
+	return size;
+}
+
+static bool read_varint(const uint8_t *buffer, size_t size, size_t *offset, uint64_t *value) {
+	uint64_t result = 0;
+	for (int shift = 0; shift < 64 && *offset < size; shift += 7) {
+		uint8_t byte = buffer[(*offset)++];
+		result |= (uint64_t)(byte & 0x7f) << shift;
+		if ((byte & 0x80) == 0) {
+			*value = result;
+			return true;
+		}
+	}
+	return false;
+}
+
+static uint64_t zigzag_encode(int64_t value) {
+	return ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+}
+
+static int64_t zigzag_decode(uint64_t value) {
+	return (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+}
+
+static int event_index(godice_event_t event) {
+	for (int index = 0; index < 32; index++) {
+		if ((uint32_t)event == (uint32_t)1 << index) {
+			return index;
+		}
+	}
+	return -1;
+}
+
+godice_status_t godice_wire_writer_init(godice_wire_writer_t *writer, uint8_t *buffer, size_t size, uint8_t flags) {
+	if (size < GODICE_WIRE_HEADER_SIZE) {
+		return GODICE_BUFFER_TOO_SMALL;
+	}
+	if ((flags & ~GODICE_WIRE_COMPRESSED) != 0) {
+		return GODICE_INVALID_ARGUMENT;
+	}
+	buffer[0] = WireMagic[0];
+	buffer[1] = WireMagic[1];
+	buffer[2] = GODICE_WIRE_VERSION;
+	buffer[3] = flags;
+	write_le(buffer + 4, 0, 2);
+	writer->buffer = buffer;
+	writer->size = size;
+	writer->used = GODICE_WIRE_HEADER_SIZE;
+	writer->count = 0;
+	writer->flags = flags;
+	writer->last_dice_id = 0;
+	writer->last_timestamp_ms = 0;
+	return GODICE_OK;
+}
+
+godice_status_t godice_wire_writer_add(godice_wire_writer_t *writer, const godice_wire_event_t *event) {
+	int index = event_index(event->event);
+	if (index < 0) {
+		return GODICE_INVALID_ARGUMENT;
+	}
+	if (writer->count == UINT16_MAX) {
+		return GODICE_LIMIT_REACHED;
+	}
+	uint8_t record[GODICE_WIRE_MAX_RECORD_SIZE];
+	size_t record_size;
+	if (writer->flags & GODICE_WIRE_COMPRESSED) {
+		record_size = write_varint(record, zigzag_encode((int64_t)event->dice_id - (int64_t)writer->last_dice_id));
+		record_size += write_varint(record + record_size,
+									zigzag_encode((int64_t)(event->timestamp_ms - writer->last_timestamp_ms)));
+		record[record_size++] = (uint8_t)index;
+		record[record_size++] = event->value;
+	} else {
+		write_le(record, event->timestamp_ms, 8);
+		write_le(record + 8, event->dice_id, 4);
+		record[12] = (uint8_t)index;
+		record[13] = event->value;
+		write_le(record + 14, 0, 2);
+		record_size = GODICE_WIRE_FIXED_RECORD_SIZE;
+	}
+	if (writer->size - writer->used < record_size) {
+		return GODICE_BUFFER_TOO_SMALL;
+	}
+	for (size_t i = 0; i < record_size; i++) {
+		writer->buffer[writer->used + i] = record[i];
+	}
+	writer->used += record_size;
+	writer->count++;
+	writer->last_dice_id = event->dice_id;
+	writer->last_timestamp_ms = event->timestamp_ms;
+	return GODICE_OK;
+}
+
+size_t godice_wire_writer_finish(godice_wire_writer_t *writer) {
+	write_le(writer->buffer + 4, writer->count, 2);
+	return writer->used;
+}
+
+godice_status_t godice_wire_reader_init(godice_wire_reader_t *reader, const uint8_t *buffer, size_t size) {
+	if (size < GODICE_WIRE_HEADER_SIZE ||
+		buffer[0] != WireMagic[0] || buffer[1] != WireMagic[1] ||
+		buffer[2] != GODICE_WIRE_VERSION || (buffer[3] & ~GODICE_WIRE_COMPRESSED) != 0) {
+		return GODICE_INVALID_PACKET;
+	}
+	reader->buffer = buffer;
+	reader->size = size;
+	reader->offset = GODICE_WIRE_HEADER_SIZE;
+	reader->count = (uint16_t)read_le(buffer + 4, 2);
+	reader->read = 0;
+	reader->flags = buffer[3];
+	reader->last_dice_id = 0;
+	reader->last_timestamp_ms = 0;
+	if (!(reader->flags & GODICE_WIRE_COMPRESSED) &&
+		size < GODICE_WIRE_HEADER_SIZE + (size_t)reader->count * GODICE_WIRE_FIXED_RECORD_SIZE) {
+		return GODICE_INVALID_PACKET;
+	}
+	return GODICE_OK;
+}
+
+static godice_status_t read_fixed_record(const uint8_t *record, godice_wire_event_t *event) {
+	if (record[12] >= 32) {
+		return GODICE_INVALID_PACKET;
+	}
+	event->timestamp_ms = read_le(record, 8);
+	event->dice_id = (uint32_t)read_le(record + 8, 4);
+	event->event = (godice_event_t)((uint32_t)1 << record[12]);
+	event->value = record[13];
+	return GODICE_OK;
+}
+
+godice_status_t godice_wire_reader_next(godice_wire_reader_t *reader, godice_wire_event_t *event) {
+	if (reader->read >= reader->count) {
+		return GODICE_LIMIT_REACHED;
+	}
+	if (!(reader->flags & GODICE_WIRE_COMPRESSED)) {
+		godice_status_t status = read_fixed_record(reader->buffer + reader->offset, event);
+		if (status != GODICE_OK) {
+			return status;
+		}
+		reader->offset += GODICE_WIRE_FIXED_RECORD_SIZE;
+		reader->read++;
+		return GODICE_OK;
+	}
+
+	size_t offset = reader->offset;
+	uint64_t dice_delta;
+	uint64_t time_delta;
+	if (!read_varint(reader->buffer, reader->size, &offset, &dice_delta) ||
+		!read_varint(reader->buffer, reader->size, &offset, &time_delta) ||
+		reader->size - offset < 2 || reader->buffer[offset] >= 32) {
+		return GODICE_INVALID_PACKET;
+	}
+	event->dice_id = (uint32_t)((int64_t)reader->last_dice_id + zigzag_decode(dice_delta));
+	event->timestamp_ms = reader->last_timestamp_ms + (uint64_t)zigzag_decode(time_delta);
+	event->event = (godice_event_t)((uint32_t)1 << reader->buffer[offset]);
+	event->value = reader->buffer[offset + 1];
+	reader->offset = offset + 2;
+	reader->read++;
+	reader->last_dice_id = event->dice_id;
+	reader->last_timestamp_ms = event->timestamp_ms;
+	return GODICE_OK;
+}
+
+godice_status_t godice_wire_reader_at(const godice_wire_reader_t *reader, uint16_t index, godice_wire_event_t *event) {
+	if (reader->flags & GODICE_WIRE_COMPRESSED) {
+		return GODICE_INVALID_ARGUMENT;
+	}
+	if (index >= reader->count) {
+		return GODICE_LIMIT_REACHED;
+	}
+	return read_fixed_record(reader->buffer + GODICE_WIRE_HEADER_SIZE + (size_t)index * GODICE_WIRE_FIXED_RECORD_SIZE,
+							 event);
+}
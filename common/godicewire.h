@@ -0,0 +1,77 @@
+#ifndef __GODICESDK_GODICEWIRE_H
+#define __GODICESDK_GODICEWIRE_H
+
+#include "godiceapi.h"
+
+// Batch of decoded events:
+//   'G' 'W' version flags   header
+//   uint16 count            number of events (little endian)
+//   events                  fixed layout or compressed records
+//
+// Fixed layout record (GODICE_WIRE_FIXED_RECORD_SIZE bytes, little endian):
+//   uint64 timestamp_ms, uint32 dice_id, uint8 event index, uint8 value, uint16 reserved
+// Compressed record (GODICE_WIRE_COMPRESSED flag):
+//   varint zigzag(dice_id - previous dice_id), varint zigzag(timestamp - previous timestamp),
+//   uint8 event index, uint8 value
+// Event index is the bit number of `godice_event_t` flag. Value is the stable number,
+// charge level, charging state or color, 0 for other events.
+
+#define GODICE_WIRE_VERSION 1
+#define GODICE_WIRE_HEADER_SIZE 6
+#define GODICE_WIRE_FIXED_RECORD_SIZE 16
+#define GODICE_WIRE_MAX_RECORD_SIZE 17
+
+#define GODICE_WIRE_COMPRESSED 0x01
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+	uint64_t timestamp_ms;
+	uint32_t dice_id;
+	godice_event_t event;
+	uint8_t value;
+} godice_wire_event_t;
+
+typedef struct {
+	uint8_t *buffer;
+	size_t size;
+	size_t used;
+	uint16_t count;
+	uint8_t flags;
+	uint32_t last_dice_id;
+	uint64_t last_timestamp_ms;
+} godice_wire_writer_t;
+
+typedef struct {
+	const uint8_t *buffer;
+	size_t size;
+	size_t offset;
+	uint16_t count;
+	uint16_t read;
+	uint8_t flags;
+	uint32_t last_dice_id;
+	uint64_t last_timestamp_ms;
+} godice_wire_reader_t;
+
+// Starts a batch in caller supplied buffer. `flags` is 0 or `GODICE_WIRE_COMPRESSED`.
+godice_status_t godice_wire_writer_init(godice_wire_writer_t *writer, uint8_t *buffer, size_t size, uint8_t flags);
+// Appends an event. Returns `GODICE_BUFFER_TOO_SMALL` if it doesn't fit, the batch written
+// so far stays valid and can be finished.
+godice_status_t godice_wire_writer_add(godice_wire_writer_t *writer, const godice_wire_event_t *event);
+// Completes the batch, returns its size in bytes
+size_t godice_wire_writer_finish(godice_wire_writer_t *writer);
+
+// Reads events directly from `buffer`, which must stay valid while reading
+godice_status_t godice_wire_reader_init(godice_wire_reader_t *reader, const uint8_t *buffer, size_t size);
+// Returns `GODICE_LIMIT_REACHED` after the last event of the batch
+godice_status_t godice_wire_reader_next(godice_wire_reader_t *reader, godice_wire_event_t *event);
+// Random access to fixed layout batches
+godice_status_t godice_wire_reader_at(const godice_wire_reader_t *reader, uint16_t index, godice_wire_event_t *event);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __GODICESDK_GODICEWIRE_H
@@ -0,0 +1,136 @@
+// Exhaustive comparison of face classification backends against the reference
+// `axis_to_value` + transform implementation over every axis_t value and dice type.
+// Reports every mismatching axis (up to MAX_REPORTED_MISMATCHES per backend) and
+// per-core throughput of each backend. Needs the float reference, so must not be
+// built with GODICE_INTEGER_ONLY.
+
+#include "godiceapi.c"
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+
+#define MAX_REPORTED_MISMATCHES 16
+
+typedef int (*classifier_t)(const diceType_t *dice_type, const axis_t *axis);
+
+static int reference_classifier(const diceType_t *dice_type, const axis_t *axis) {
+	int raw_roll = axis_to_value(dice_type->values, dice_type->values_num, axis);
+	return dice_type_value(dice_type, raw_roll);
+}
+
+static int integer_classifier(const diceType_t *dice_type, const axis_t *axis) {
+	godice_classification_t result;
+	classify_faces(dice_type, axis, &result);
+	return result.value;
+}
+
+static int calibrated_classifier(const diceType_t *dice_type, const axis_t *axis) {
+	// Freshly initialized calibration holds the nominal faces in fixed point
+	static _Thread_local godice_calibration_t calibration;
+	if (calibration.dice_max != dice_type->max) {
+		godice_calibration_init(&calibration, dice_type->max);
+		calibration.learning = false;
+	}
+	godice_classification_t result;
+	classify_calibrated(dice_type, &calibration, axis, &result);
+	return result.value;
+}
+
+typedef struct {
+	const char *name;
+	classifier_t classify;
+	_Atomic uint64_t nanoseconds;
+	_Atomic uint64_t mismatches;
+} backend_t;
+
+static backend_t Backends[] = {
+	{ "integer", integer_classifier, 0, 0 },
+	{ "calibrated", calibrated_classifier, 0, 0 },
+};
+
+static _Atomic uint64_t ReferenceNanoseconds;
+static _Atomic int NextSlice;
+static pthread_mutex_t ReportLock = PTHREAD_MUTEX_INITIALIZER;
+
+static uint64_t thread_time_ns(void) {
+	struct timespec time;
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &time);
+	return (uint64_t)time.tv_sec * 1000000000u + (uint64_t)time.tv_nsec;
+}
+
+// Classifies all 65536 axes with the given x using `classify`, returns CPU time spent
+static uint64_t classify_slice(classifier_t classify, const diceType_t *dice_type,
+							   int8_t x, uint8_t *values) {
+	uint64_t start = thread_time_ns();
+	axis_t axis = { x, 0, 0 };
+	for (int yz = 0; yz < 65536; yz++) {
+		axis.y = (int8_t)(yz >> 8);
+		axis.z = (int8_t)(yz & 0xff);
+		values[yz] = (uint8_t)classify(dice_type, &axis);
+	}
+	return thread_time_ns() - start;
+}
+
+static void *worker(void *arg) {
+	(void)arg;
+	static _Thread_local uint8_t expected[65536];
+	static _Thread_local uint8_t actual[65536];
+	int slices = 256 * (int)countof(DiceTypes);
+	for (int slice = NextSlice++; slice < slices; slice = NextSlice++) {
+		const diceType_t *dice_type = &DiceTypes[slice / 256];
+		int8_t x = (int8_t)(slice % 256);
+		ReferenceNanoseconds += classify_slice(reference_classifier, dice_type, x, expected);
+		for (size_t b = 0; b < countof(Backends); b++) {
+			backend_t *backend = &Backends[b];
+			backend->nanoseconds += classify_slice(backend->classify, dice_type, x, actual);
+			for (int yz = 0; yz < 65536; yz++) {
+				if (actual[yz] == expected[yz]) {
+					continue;
+				}
+				uint64_t reported = backend->mismatches++;
+				if (reported < MAX_REPORTED_MISMATCHES) {
+					pthread_mutex_lock(&ReportLock);
+					printf("%s: %s axis (%d, %d, %d) expected %d got %d\n",
+						   backend->name, dice_type->name,
+						   (int)x, (int)(int8_t)(yz >> 8), (int)(int8_t)(yz & 0xff),
+						   (int)expected[yz], (int)actual[yz]);
+					pthread_mutex_unlock(&ReportLock);
+				}
+			}
+		}
+	}
+	return NULL;
+}
+
+static void print_throughput(const char *name, uint64_t nanoseconds, uint64_t mismatches) {
+	double classifications = 16777216.0 * countof(DiceTypes);
+	printf("%-12s %8.1f M/s per core  %llu mismatches\n",
+		   name, classifications / ((double)nanoseconds / 1e9) / 1e6,
+		   (unsigned long long)mismatches);
+}
+
+int main(void) {
+	long threads_num = sysconf(_SC_NPROCESSORS_ONLN);
+	if (threads_num < 1) {
+		threads_num = 1;
+	}
+	pthread_t *threads = calloc((size_t)threads_num, sizeof(pthread_t));
+	for (long i = 0; i < threads_num; i++) {
+		pthread_create(&threads[i], NULL, worker, NULL);
+	}
+	for (long i = 0; i < threads_num; i++) {
+		pthread_join(threads[i], NULL);
+	}
+	free(threads);
+
+	printf("%ld threads, %d dice types x 2^24 axes\n", threads_num, (int)countof(DiceTypes));
+	print_throughput("reference", ReferenceNanoseconds, 0);
+	int failed = 0;
+	for (size_t b = 0; b < countof(Backends); b++) {
+		print_throughput(Backends[b].name, Backends[b].nanoseconds, Backends[b].mismatches);
+		failed |= Backends[b].mismatches != 0;
+	}
+	return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,35 @@
+# Fails if the embedded profile library references heap, libm, soft-float or libatomic functions.
+# Usage: cmake -DNM=<nm> -DLIBRARY=<archive> -P embedded_check.cmake
+
+set(FORBIDDEN
+	malloc calloc realloc free aligned_alloc posix_memalign
+	sqrt sqrtf log logf exp expf pow powf floor floorf ceil ceilf fabs fabsf)
+
+execute_process(COMMAND ${NM} -u ${LIBRARY}
+				OUTPUT_VARIABLE UNDEFINED
+				RESULT_VARIABLE RESULT)
+if(NOT RESULT EQUAL 0)
+	message(FATAL_ERROR "${NM} failed on ${LIBRARY}")
+endif()
+
+string(REGEX MATCHALL "[A-Za-z_][A-Za-z0-9_]*" SYMBOLS "${UNDEFINED}")
+foreach(SYMBOL ${FORBIDDEN})
+	list(FIND SYMBOLS ${SYMBOL} INDEX)
+	if(NOT INDEX EQUAL -1)
+		message(FATAL_ERROR "embedded profile pulls in ${SYMBOL}")
+	endif()
+endforeach()
+
+# libgcc and ARM EABI floating point helpers, e.g. __adddf3, __floatsidf, __aeabi_dmul
+foreach(SYMBOL ${SYMBOLS})
+	if(SYMBOL MATCHES "^__(add|sub|mul|div|neg|cmp|eq|ne|lt|le|gt|ge|unord)(sf|df)[0-9]$" OR
+	   SYMBOL MATCHES "^__(float|fix)[a-z]*(sf|df)[a-z]*$" OR
+	   SYMBOL MATCHES "^__(extend|trunc)(sf|df)(sf|df)2$" OR
+	   SYMBOL MATCHES "^__aeabi_[fd]")
+		message(FATAL_ERROR "embedded profile pulls in floating point helper ${SYMBOL}")
+	endif()
+	# Atomics that are not lock-free are libatomic calls, e.g. __atomic_load_8
+	if(SYMBOL MATCHES "^__atomic_")
+		message(FATAL_ERROR "embedded profile pulls in libatomic ${SYMBOL}")
+	endif()
+endforeach()
@@ -1,25 +1,704 @@
 #include <iostream>
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
 #include "godiceapi.h"
+#include "godicebattery.h"
+#include "godicefleet.h"
+#include "godicepool.h"
+#include "godiceshow.h"
+#include "godicestats.h"
+#include "godicetuner.h"
+#include "godicewire.h"
 
 using namespace std;
 
+struct recorded_t {
+	vector<int> stables;
+	vector<godice_stable_kind_t> kinds;
+	int rolls = 0;
+};
+
+static godice_callbacks_t recording_callbacks() {
+	godice_callbacks_t callbacks = {};
+	callbacks.on_dice_roll = [](void *userdata, int dice_id) {
+		(void)dice_id;
+		((recorded_t*)userdata)->rolls++;
+	};
+	callbacks.on_dice_stable_kind = [](void *userdata, int dice_id, uint8_t number, godice_stable_kind_t kind) {
+		(void)dice_id;
+		((recorded_t*)userdata)->stables.push_back(number);
+		((recorded_t*)userdata)->kinds.push_back(kind);
+	};
+	return callbacks;
+}
+
 void test_stables() {
-	godiceapi_callbacks_t callbacks = {
-		.on_dice_roll = [](void *userdata, int dice_id, int number) {
-			cout << number << endl;
-		}
+	godice_callbacks_t callbacks = {};
+	callbacks.on_dice_stable = [](void *userdata, int dice_id, uint8_t number) {
+		(void)userdata;
+		(void)dice_id;
+		cout << (int)number << endl;
 	};
 	{
 		uint8_t packet[] = {'S', 0, 0, (uint8_t)-64};
-		incoming_packet(&callbacks, nullptr, 0, packet, sizeof(packet));
+		assert(godice_incoming_packet(&callbacks, nullptr, 0, 6, packet, sizeof(packet)) == GODICE_OK);
 	}
 	{
 		uint8_t packet[] = {'F', 'S', 128, 128, 128};
-		incoming_packet(&callbacks, nullptr, 0, packet, sizeof(packet));
+		assert(godice_incoming_packet(&callbacks, nullptr, 0, 6, packet, sizeof(packet)) == GODICE_OK);
+	}
+}
+
+void test_tracked_stables() {
+	godice_callbacks_t callbacks = recording_callbacks();
+	godice_dice_state_t state;
+	godice_dice_state_reset(&state);
+	recorded_t recorded;
+
+	uint8_t roll[] = {'R'};
+	uint8_t fake_five[] = {'F', 'S', 0, 0, (uint8_t)-64};
+	uint8_t tilt_five[] = {'T', 'S', 0, 0, (uint8_t)-60};
+	uint8_t stable_five[] = {'S', 0, 0, (uint8_t)-64};
+	uint8_t stable_two[] = {'S', 0, 0, 64};
+
+	godice_incoming_packet_tracked(&callbacks, &recorded, &state, 0, 6, roll, sizeof(roll));
+	godice_incoming_packet_tracked(&callbacks, &recorded, &state, 0, 6, roll, sizeof(roll));
+	godice_incoming_packet_tracked(&callbacks, &recorded, &state, 0, 6, fake_five, sizeof(fake_five));
+	godice_incoming_packet_tracked(&callbacks, &recorded, &state, 0, 6, tilt_five, sizeof(tilt_five));
+	godice_incoming_packet_tracked(&callbacks, &recorded, &state, 0, 6, stable_five, sizeof(stable_five));
+	godice_incoming_packet_tracked(&callbacks, &recorded, &state, 0, 6, stable_five, sizeof(stable_five));
+	godice_incoming_packet_tracked(&callbacks, &recorded, &state, 0, 6, stable_two, sizeof(stable_two));
+	godice_incoming_packet_tracked(&callbacks, &recorded, &state, 0, 6, roll, sizeof(roll));
+	godice_incoming_packet_tracked(&callbacks, &recorded, &state, 0, 6, stable_two, sizeof(stable_two));
+
+	assert(recorded.rolls == 2);
+	assert((recorded.stables == vector<int>{5, 5, 2, 2}));
+	assert(recorded.kinds[0] == GODICE_FAKE_STABLE);
+	assert(recorded.kinds[1] == GODICE_STABLE);
+
+	// Rolls are tracked without roll callback, same face after a roll is reported again
+	callbacks.on_dice_roll = NULL;
+	godice_dice_state_reset(&state);
+	recorded.stables.clear();
+	for (int i = 0; i < 3; i++) {
+		assert(godice_incoming_packet_tracked(&callbacks, &recorded, &state, 0, 6, roll, sizeof(roll)) == GODICE_INVALID_CALLBACK);
+		assert(godice_incoming_packet_tracked(&callbacks, &recorded, &state, 0, 6, stable_five, sizeof(stable_five)) == GODICE_OK);
+	}
+	assert((recorded.stables == vector<int>{5, 5, 5}));
+
+	// Stables are tracked without stable callbacks, every roll is reported
+	callbacks = recording_callbacks();
+	callbacks.on_dice_stable = NULL;
+	callbacks.on_dice_stable_kind = NULL;
+	godice_dice_state_reset(&state);
+	recorded.rolls = 0;
+	for (int i = 0; i < 3; i++) {
+		assert(godice_incoming_packet_tracked(&callbacks, &recorded, &state, 0, 6, roll, sizeof(roll)) == GODICE_OK);
+		assert(godice_incoming_packet_tracked(&callbacks, &recorded, &state, 0, 6, stable_five, sizeof(stable_five)) == GODICE_INVALID_CALLBACK);
+	}
+	assert(recorded.rolls == 3);
+}
+
+void test_stats() {
+	godice_stats_t stats;
+	assert(godice_stats_init(&stats, 7) == GODICE_INVALID_ARGUMENT);
+	assert(godice_stats_init(&stats, 100) == GODICE_OK);
+	assert(stats.values_num == 10 && stats.values[0] == 0 && stats.values[9] == 90);
+
+	assert(godice_stats_init(&stats, 6) == GODICE_OK);
+	int raised = GODICE_STATS_ALERT_NONE;
+	for (int i = 0; i < 600; i++) {
+		raised |= godice_stats_add(&stats, (uint8_t)(i % 6 + 1));
+	}
+	assert(raised == GODICE_STATS_ALERT_NONE);
+	assert(godice_stats_chi_square(&stats) < GODICE_STATS_SCORE(0.01));
+#ifndef GODICE_INTEGER_ONLY
+	assert(godice_stats_g_test(&stats) < 1e-9);
+#endif
+
+	for (int i = 0; i < 120; i++) {
+		raised |= godice_stats_add(&stats, 6);
+	}
+	assert(raised == (GODICE_STATS_ALERT_TOTAL | GODICE_STATS_ALERT_WINDOW));
+	assert(godice_stats_window_chi_square(&stats) > godice_stats_chi_square(&stats));
+	// 15.09 is the exact critical value for 5 degrees of freedom at p = 0.01
+	godice_stats_score_t critical = godice_stats_critical_value(5, GODICE_STATS_SCORE(2.326));
+	assert(critical > GODICE_STATS_SCORE(14.9) && critical < GODICE_STATS_SCORE(15.3));
+	// 720 rolls, 220 of them sixes: 6 / 720 * (5 * 100^2 + 220^2) - 720 == 100
+	assert(godice_stats_chi_square(&stats) > GODICE_STATS_SCORE(99.9) &&
+		   godice_stats_chi_square(&stats) < GODICE_STATS_SCORE(100.1));
+}
+
+void test_registered_dice_type() {
+	const godice_axis_t faces[] = {
+		{ -64, 0, 0 }, { 0, 0, 64 }, { 0, 64, 0 }, { 0, -64, 0 }, { 0, 0, -64 }, { 64, 0, 0 },
+	};
+	const uint8_t face_values[] = { 1, 2, 3, 3, 2, 1 };
+	assert(godice_register_dice_type(6, "D6", faces, face_values, 6) == GODICE_INVALID_ARGUMENT);
+	assert(godice_register_dice_type(3, "D3", faces, face_values, 6) == GODICE_OK);
+	assert(godice_register_dice_type(3, "D3", faces, face_values, 6) == GODICE_INVALID_ARGUMENT);
+	assert(string(godice_dice_type_name(3)) == "D3");
+	assert(string(godice_dice_type_name(100)) == "D10X");
+
+	uint8_t values[GODICE_MAX_DICE_VALUES];
+	size_t values_num;
+	assert(godice_dice_values(3, values, sizeof(values), &values_num) == GODICE_OK);
+	assert(values_num == 3 && values[0] == 1 && values[2] == 3);
+
+	godice_callbacks_t callbacks = recording_callbacks();
+	recorded_t recorded;
+	uint8_t packet[] = {'S', 0, (uint8_t)-60, 2};
+	godice_incoming_packet(&callbacks, &recorded, 0, 3, packet, sizeof(packet));
+	assert((recorded.stables == vector<int>{3}));
+}
+
+void test_classification_margin() {
+	godice_classification_t result;
+	godice_axis_t flat = { 0, 0, -64 };
+	assert(godice_classify_axis(6, &flat, &result) == GODICE_OK);
+	assert(result.face == 5 && result.value == 5 && result.distance_sq == 0);
+	assert(result.margin_sq == 2 * 64 * 64);
+
+	godice_axis_t tilted = { -32, 0, 32 };
+	assert(godice_classify_axis(6, &tilted, &result) == GODICE_OK);
+	assert(result.value == 1 && result.margin_sq == 0);
+
+	uint8_t packet[] = {'T', 'S', 0, 0, (uint8_t)-64};
+	assert(godice_classify_stable_packet(6, packet, sizeof(packet), &result) == GODICE_OK);
+	assert(result.value == 5);
+	uint8_t roll[] = {'R'};
+	assert(godice_classify_stable_packet(6, roll, sizeof(roll), &result) == GODICE_INVALID_PACKET);
+}
+
+void test_calibration() {
+	godice_calibration_t calibration;
+	assert(godice_calibration_init(&calibration, 6) == GODICE_OK);
+	godice_callbacks_t callbacks = recording_callbacks();
+	recorded_t recorded;
+	godice_dice_state_t state;
+	godice_dice_state_reset(&state);
+	state.calibration = &calibration;
+
+	// Face 5 of this dice reads noticeably off the nominal {0, 0, -64}
+	uint8_t biased_five[] = {'S', 30, 0, (uint8_t)-56};
+	uint8_t roll[] = {'R'};
+	for (int i = 0; i < 100; i++) {
+		godice_incoming_packet_tracked(&callbacks, &recorded, &state, 0, 6, roll, sizeof(roll));
+		godice_incoming_packet_tracked(&callbacks, &recorded, &state, 0, 6, biased_five, sizeof(biased_five));
+	}
+	assert(calibration.samples[4] == 100);
+	assert(calibration.centroids[4][0] > 28 * GODICE_CALIBRATION_SCALE);
+
+	godice_classification_t result;
+	godice_axis_t tilted = { 44, 0, -40 };
+	assert(godice_classify_axis(6, &tilted, &result) == GODICE_OK && result.value == 6);
+	calibration.learning = false;
+	assert(godice_calibration_classify_axis(&calibration, &tilted, &result) == GODICE_OK);
+	assert(result.value == 5);
+
+	uint8_t exported[GODICE_CALIBRATION_EXPORT_SIZE(GODICE_MAX_DICE_FACES)];
+	size_t exported_size;
+	assert(godice_calibration_export(&calibration, exported, sizeof(exported), &exported_size) == GODICE_OK);
+	assert(exported_size == GODICE_CALIBRATION_EXPORT_SIZE(6));
+	godice_calibration_t imported;
+	assert(godice_calibration_import(&imported, exported, exported_size) == GODICE_OK);
+	assert(imported.samples[4] == 100);
+	assert(imported.centroids[4][0] == calibration.centroids[4][0]);
+	assert(imported.centroids[4][2] == calibration.centroids[4][2]);
+	// Rejected buffers leave the calibration unchanged
+	exported[3 + 4 * 8 + 1] = 0x7f;
+	assert(godice_calibration_import(&imported, exported, exported_size) == GODICE_INVALID_PACKET);
+	exported[3 + 4 * 8 + 1] = (uint8_t)(calibration.centroids[4][0] >> 8);
+	exported[1] = 20;
+	assert(godice_calibration_import(&imported, exported, exported_size) == GODICE_INVALID_PACKET);
+	assert(imported.dice_max == 6 && imported.samples[4] == 100);
+	assert(imported.centroids[4][0] == calibration.centroids[4][0]);
+}
+
+// Simulated dice: fewer samples/movement/face counts and a wider flat window shorten
+// roll-to-result time, but with less than 3 samples every other stable is fake and above
+// 58 degrees every other stable is tilted
+struct simulated_dice_t {
+	godice_detection_settings_t settings;
+
+	uint32_t latency_ms() const {
+		return 30 * settings.samples_count + 60 * settings.movement_count +
+			40 * settings.face_count + 2 * settings.roll_threshold + 10 * (90 - settings.max_flat_deg);
+	}
+
+	godice_stable_kind_t stable_kind(int roll) const {
+		if (settings.samples_count < 3 && roll % 2 == 0) {
+			return GODICE_FAKE_STABLE;
+		}
+		return settings.max_flat_deg > 58 && roll % 2 == 1 ? GODICE_TILT_STABLE : GODICE_STABLE;
+	}
+
+	void write(const uint8_t *packet, size_t size) {
+		assert(size == GODICE_DETECTION_SETTINGS_UPDATE_PACKET_SIZE && packet[0] == 0x65);
+		settings.samples_count = packet[1];
+		settings.movement_count = packet[2];
+		settings.face_count = packet[3];
+		settings.min_flat_deg = packet[4];
+		settings.max_flat_deg = packet[5];
+		settings.roll_threshold = packet[8];
+	}
+};
+
+void test_tuner() {
+	simulated_dice_t dice;
+	godice_detection_settings_default(&dice.settings);
+	uint32_t initial_latency = dice.latency_ms();
+	godice_tuner_t tuner;
+	godice_tuner_init(&tuner, &dice.settings);
+
+	uint32_t now = 0;
+	int updates = 0;
+	for (int roll = 0; roll < 5000 && !tuner.converged; roll++) {
+		godice_tuner_on_roll(&tuner, now);
+		now += dice.latency_ms();
+		if (godice_tuner_on_stable(&tuner, now, dice.stable_kind(roll))) {
+			uint8_t packet[GODICE_DETECTION_SETTINGS_UPDATE_PACKET_SIZE];
+			size_t written;
+			assert(godice_tuner_update_packet(&tuner, packet, sizeof(packet), &written) == GODICE_OK);
+			dice.write(packet, written);
+			updates++;
+		}
+		now += 1000;
+	}
+	assert(tuner.converged);
+	assert(dice.settings.samples_count == 3);
+	assert(dice.settings.movement_count == 1);
+	assert(dice.settings.max_flat_deg == 58);
+	assert(dice.settings.min_flat_deg < dice.settings.max_flat_deg);
+	assert(dice.latency_ms() < initial_latency);
+	assert(updates < 40);
+
+	// Fake stable rate creeping up by 2 percent points per trial is held to the initial rate
+	godice_detection_settings_t settings;
+	godice_detection_settings_default(&settings);
+	godice_tuner_init(&tuner, &settings);
+	uint32_t latency = 1000;
+	uint32_t accepted_latency[4];
+	for (int trial = 0; trial < 4; trial++) {
+		int bad = trial * GODICE_TUNER_TRIAL_ROLLS / 50;
+		for (int roll = 0; roll < GODICE_TUNER_TRIAL_ROLLS; roll++) {
+			godice_tuner_on_roll(&tuner, now);
+			now += latency;
+			godice_tuner_on_stable(&tuner, now, roll < bad ? GODICE_FAKE_STABLE : GODICE_STABLE);
+			now += 1000;
+		}
+		accepted_latency[trial] = tuner.best_latency_ms;
+		latency = latency * 9 / 10;
+	}
+	assert(accepted_latency[0] == 1000 && accepted_latency[1] == 900);
+	assert(accepted_latency[2] == 900 && accepted_latency[3] == 900);
+}
+
+void test_events_mask() {
+	static int taps = 0;
+	godice_callbacks_t callbacks = recording_callbacks();
+	callbacks.on_dice_tap = [](void *userdata, int dice_id) {
+		(void)userdata;
+		(void)dice_id;
+		taps++;
+	};
+	callbacks.events_mask = GODICE_EVENT_ROLL | GODICE_EVENT_STABLE | GODICE_EVENT_TAP;
+	recorded_t recorded;
+
+	uint8_t tap[] = {'T', 'a', 'p'};
+	uint8_t double_tap[] = {'D', 'T', 'a', 'p'};
+	uint8_t fake_five[] = {'F', 'S', 0, 0, (uint8_t)-64};
+	uint8_t stable_five[] = {'S', 0, 0, (uint8_t)-64};
+	uint8_t battery[] = {'B', 'a', 't', 50};
+	uint8_t unknown[] = {'X'};
+	assert(godice_incoming_packet(&callbacks, &recorded, 0, 6, tap, sizeof(tap)) == GODICE_OK);
+	assert(godice_incoming_packet(&callbacks, &recorded, 0, 6, double_tap, sizeof(double_tap)) == GODICE_NOT_SUBSCRIBED);
+	assert(godice_incoming_packet(&callbacks, &recorded, 0, 6, fake_five, sizeof(fake_five)) == GODICE_NOT_SUBSCRIBED);
+	assert(godice_incoming_packet(&callbacks, &recorded, 0, 6, stable_five, sizeof(stable_five)) == GODICE_OK);
+	assert(godice_incoming_packet(&callbacks, &recorded, 0, 6, battery, sizeof(battery)) == GODICE_NOT_SUBSCRIBED);
+	assert(godice_incoming_packet(&callbacks, &recorded, 0, 6, unknown, sizeof(unknown)) == GODICE_INVALID_PACKET);
+	assert(taps == 1);
+	assert((recorded.stables == vector<int>{5}));
+
+	// Unsubscribed rolls still separate tracked stables on the same face
+	callbacks.events_mask = GODICE_EVENT_STABLE;
+	godice_dice_state_t state;
+	godice_dice_state_reset(&state);
+	uint8_t roll[] = {'R'};
+	recorded.rolls = 0;
+	recorded.stables.clear();
+	for (int i = 0; i < 3; i++) {
+		assert(godice_incoming_packet_tracked(&callbacks, &recorded, &state, 0, 6, roll, sizeof(roll)) == GODICE_NOT_SUBSCRIBED);
+		assert(godice_incoming_packet_tracked(&callbacks, &recorded, &state, 0, 6, stable_five, sizeof(stable_five)) == GODICE_OK);
 	}
+	assert(recorded.rolls == 0 && (recorded.stables == vector<int>{5, 5, 5}));
+	// Unsubscribed stables end the roll, the next roll is reported
+	callbacks.events_mask = GODICE_EVENT_ROLL;
+	assert(godice_incoming_packet_tracked(&callbacks, &recorded, &state, 0, 6, roll, sizeof(roll)) == GODICE_OK);
+	assert(godice_incoming_packet_tracked(&callbacks, &recorded, &state, 0, 6, stable_five, sizeof(stable_five)) == GODICE_NOT_SUBSCRIBED);
+	assert(godice_incoming_packet_tracked(&callbacks, &recorded, &state, 0, 6, roll, sizeof(roll)) == GODICE_OK);
+	assert(recorded.rolls == 2);
+
+	callbacks.events_mask = 0;
+	assert(godice_incoming_packet(&callbacks, &recorded, 0, 6, battery, sizeof(battery)) == GODICE_INVALID_CALLBACK);
+	assert(godice_incoming_packet(&callbacks, &recorded, 0, 6, double_tap, sizeof(double_tap)) == GODICE_OK);
+	assert(godice_packet_event(double_tap, sizeof(double_tap)) == GODICE_EVENT_DOUBLE_TAP);
+	uint8_t tilt[] = {'T', 'S'};
+	assert(godice_packet_event(tilt, sizeof(tilt)) == GODICE_EVENT_TILT_STABLE);
+}
+
+void test_wire() {
+	const godice_wire_event_t events[] = {
+		{ 1700000000000ull, 12, GODICE_EVENT_ROLL, 0 },
+		{ 1700000000350ull, 12, GODICE_EVENT_STABLE, 17 },
+		{ 1700000000360ull, 9, GODICE_EVENT_BATTERY, 80 },
+		{ 1700000000300ull, 4000000000u, GODICE_EVENT_COLOR, GODICE_ORANGE },
+	};
+	for (uint8_t flags : { (uint8_t)0, (uint8_t)GODICE_WIRE_COMPRESSED }) {
+		uint8_t buffer[256];
+		godice_wire_writer_t writer;
+		assert(godice_wire_writer_init(&writer, buffer, sizeof(buffer), flags) == GODICE_OK);
+		for (const godice_wire_event_t &event : events) {
+			assert(godice_wire_writer_add(&writer, &event) == GODICE_OK);
+		}
+		size_t size = godice_wire_writer_finish(&writer);
+		if (flags == 0) {
+			assert(size == GODICE_WIRE_HEADER_SIZE + 4 * GODICE_WIRE_FIXED_RECORD_SIZE);
+		} else {
+			assert(size < GODICE_WIRE_HEADER_SIZE + 4 * 10);
+		}
+
+		godice_wire_reader_t reader;
+		assert(godice_wire_reader_init(&reader, buffer, size) == GODICE_OK);
+		godice_wire_event_t event;
+		for (const godice_wire_event_t &expected : events) {
+			assert(godice_wire_reader_next(&reader, &event) == GODICE_OK);
+			assert(event.timestamp_ms == expected.timestamp_ms && event.dice_id == expected.dice_id);
+			assert(event.event == expected.event && event.value == expected.value);
+		}
+		assert(godice_wire_reader_next(&reader, &event) == GODICE_LIMIT_REACHED);
+		if (flags == 0) {
+			assert(godice_wire_reader_at(&reader, 1, &event) == GODICE_OK && event.value == 17);
+		}
+	}
+
+	uint8_t small[GODICE_WIRE_HEADER_SIZE + GODICE_WIRE_FIXED_RECORD_SIZE + 4];
+	godice_wire_writer_t writer;
+	godice_wire_writer_init(&writer, small, sizeof(small), 0);
+	assert(godice_wire_writer_add(&writer, &events[0]) == GODICE_OK);
+	assert(godice_wire_writer_add(&writer, &events[1]) == GODICE_BUFFER_TOO_SMALL);
+	godice_wire_reader_t reader;
+	assert(godice_wire_reader_init(&reader, small, godice_wire_writer_finish(&writer)) == GODICE_OK);
+	assert(reader.count == 1);
+}
+
+void test_fleet() {
+	static godice_fleet_t fleet;
+	godice_fleet_init(&fleet);
+	godice_callbacks_t callbacks = recording_callbacks();
+	callbacks.events_mask = GODICE_EVENT_STABLE;
+	recorded_t recorded;
+
+	uint8_t roll[] = {'R'};
+	uint8_t stable_five[] = {'S', 0, 0, (uint8_t)-64};
+	uint8_t battery[] = {'B', 'a', 't', 50};
+	assert(godice_fleet_incoming_packet(&fleet, &callbacks, &recorded, 10, 6, roll, sizeof(roll)) == GODICE_OK);
+	assert(godice_fleet_incoming_packet(&fleet, &callbacks, &recorded, 10, 6, stable_five, sizeof(stable_five)) == GODICE_OK);
+	assert(godice_fleet_incoming_packet(&fleet, &callbacks, &recorded, 11, 20, battery, sizeof(battery)) == GODICE_OK);
+	assert(recorded.rolls == 0);
+	assert((recorded.stables == vector<int>{5}));
+
+	godice_fleet_dice_t dice[GODICE_FLEET_MAX_DICE];
+	size_t count;
+	uint32_t version;
+	assert(godice_fleet_snapshot(&fleet, dice, GODICE_FLEET_MAX_DICE, &count, &version) == GODICE_OK);
+	assert(count == 2);
+	assert(dice[0].dice_id == 10 && dice[0].dice_max == 6 && !dice[0].rolling && dice[0].stable && dice[0].value == 5);
+	assert(!dice[0].has_charge_level && !dice[0].has_color);
+	assert(dice[1].dice_id == 11 && dice[1].dice_max == 20 && !dice[1].stable);
+	assert(dice[1].has_charge_level && dice[1].charge_level == 50);
+
+	// Repeated stable doesn't change anything and isn't published
+	uint32_t unchanged;
+	assert(godice_fleet_incoming_packet(&fleet, NULL, NULL, 10, 6, stable_five, sizeof(stable_five)) == GODICE_OK);
+	assert(godice_fleet_snapshot(&fleet, dice, GODICE_FLEET_MAX_DICE, &count, &unchanged) == GODICE_OK);
+	assert(unchanged == version);
+	godice_fleet_reset_dice(&fleet, 10);
+	assert(godice_fleet_snapshot(&fleet, dice, 1, &count, &version) == GODICE_OK);
+	assert(count == 1 && !dice[0].stable && dice[0].dice_max == 6 && version != unchanged);
+
+	for (uint32_t dice_id = 12; dice_id < 12 + GODICE_FLEET_MAX_DICE - 2; dice_id++) {
+		assert(godice_fleet_incoming_packet(&fleet, NULL, NULL, dice_id, 6, roll, sizeof(roll)) == GODICE_OK);
+	}
+	assert(godice_fleet_incoming_packet(&fleet, NULL, NULL, 1000, 6, roll, sizeof(roll)) == GODICE_LIMIT_REACHED);
+
+	// Removed dice free their slot, the last dice moves in with its state
+	godice_fleet_remove_dice(&fleet, 10);
+	assert(godice_fleet_snapshot(&fleet, dice, GODICE_FLEET_MAX_DICE, &count, &version) == GODICE_OK);
+	assert(count == GODICE_FLEET_MAX_DICE - 1);
+	assert(dice[0].dice_id == 12 + GODICE_FLEET_MAX_DICE - 3 && dice[0].rolling);
+	assert(godice_fleet_incoming_packet(&fleet, NULL, NULL, 1000, 6, roll, sizeof(roll)) == GODICE_OK);
+	godice_fleet_remove_dice(&fleet, 1000);
+	godice_fleet_remove_dice(&fleet, 1000);
+	assert(godice_fleet_snapshot(&fleet, dice, GODICE_FLEET_MAX_DICE, &count, &version) == GODICE_OK);
+	assert(count == GODICE_FLEET_MAX_DICE - 1);
+
+	// Readers don't wait for a decoder stalled in a batch
+	godice_fleet_begin_update(&fleet);
+	assert(godice_fleet_incoming_packet(&fleet, NULL, NULL, 11, 20, roll, sizeof(roll)) == GODICE_OK);
+	size_t busy_count = 0;
+	assert(godice_fleet_snapshot(&fleet, dice, GODICE_FLEET_MAX_DICE, &busy_count, NULL) == GODICE_BUSY);
+	assert(busy_count == 0);
+	godice_fleet_end_update(&fleet);
+	assert(godice_fleet_snapshot(&fleet, dice, GODICE_FLEET_MAX_DICE, &count, NULL) == GODICE_OK);
+
+	// Both dice always roll to the same face in one update, readers must never see them differ
+	godice_fleet_init(&fleet);
+	const godice_axis_t faces[] = {
+		{ -64, 0, 0 }, { 0, 0, 64 }, { 0, 64, 0 }, { 0, -64, 0 }, { 0, 0, -64 }, { 64, 0, 0 },
+	};
+	atomic<bool> done(false);
+	atomic<int> snapshots(0);
+	thread reader([&]() {
+		godice_fleet_dice_t view[GODICE_FLEET_MAX_DICE];
+		size_t view_count;
+		while (!done) {
+			if (godice_fleet_snapshot(&fleet, view, GODICE_FLEET_MAX_DICE, &view_count, NULL) != GODICE_OK) {
+				continue;
+			}
+			if (view_count == 2) {
+				assert(view[0].rolling == view[1].rolling);
+				assert(view[0].stable == view[1].stable && view[0].value == view[1].value);
+			}
+			snapshots++;
+		}
+	});
+	for (int i = 0; i < 200000; i++) {
+		const godice_axis_t &face = faces[i % 6];
+		uint8_t stable[] = {'S', (uint8_t)face.x, (uint8_t)face.y, (uint8_t)face.z};
+		godice_fleet_begin_update(&fleet);
+		for (uint32_t dice_id = 0; dice_id < 2; dice_id++) {
+			assert(godice_fleet_incoming_packet(&fleet, NULL, NULL, dice_id, 6, roll, sizeof(roll)) == GODICE_OK);
+			assert(godice_fleet_incoming_packet(&fleet, NULL, NULL, dice_id, 6, stable, sizeof(stable)) == GODICE_OK);
+		}
+		godice_fleet_end_update(&fleet);
+	}
+	done = true;
+	reader.join();
+	assert(snapshots > 0);
+	assert(godice_fleet_snapshot(&fleet, dice, GODICE_FLEET_MAX_DICE, &count, &version) == GODICE_OK);
+	assert(count == 2 && dice[0].value == 199999 % 6 + 1 && dice[1].value == dice[0].value);
+}
+
+void test_show() {
+	const godice_leds_colors_t red = { 255, 0, 0, 255, 0, 0 };
+	const godice_leds_colors_t green = { 0, 255, 0, 0, 255, 0 };
+	const godice_leds_colors_t blue_led1 = { 0, 0, 255, 0, 0, 0 };
+	const godice_leds_colors_t mixed = { 255, 0, 0, 0, 255, 0 };
+	const godice_leds_colors_t black = {};
+
+	// Five blinks, then green, then off
+	vector<godice_keyframe_t> blinking;
+	for (uint32_t i = 0; i < 5; i++) {
+		blinking.push_back({ i * 200, red });
+		blinking.push_back({ i * 200 + 100, black });
+	}
+	blinking.push_back({ 2000, green });
+	blinking.push_back({ 2500, green });
+	const godice_keyframe_t looping[] = { { 0, blue_led1 }, { 50, black } };
+	const godice_keyframe_t stepping[] = { { 15, mixed }, { 30, black }, { 45, mixed }, { 60, black } };
+	const uint32_t group[] = { 1, 2 };
+	const uint32_t single[] = { 3 };
+	const godice_show_track_t tracks[] = {
+		{ group, 2, blinking.data(), blinking.size(), 3000, false },
+		{ single, 1, looping, 2, 200, true },
+		{ single, 1, stepping, 4, 0, false },
+	};
+
+	godice_show_command_t commands[16];
+	size_t count;
+	assert(godice_show_compile(tracks, 3, commands, 16, &count) == GODICE_OK);
+	assert(count == 7);
+	const uint8_t red_blinks[] = { 0x10, 5, 10, 10, 255, 0, 0, GODICE_BLINK_PARALLEL, GODICE_LEDS_BOTH };
+	const uint8_t blue_loop[] = { 0x10, GODICE_BLINKS_INFINITE, 5, 15, 0, 0, 255, GODICE_BLINK_PARALLEL, GODICE_LED1 };
+	assert(commands[0].time_ms == 0 && commands[0].track == 0 && memcmp(commands[0].packet, red_blinks, sizeof(red_blinks)) == 0);
+	assert(commands[1].time_ms == 0 && commands[1].track == 1 && memcmp(commands[1].packet, blue_loop, sizeof(blue_loop)) == 0);
+	assert(commands[2].time_ms == 15 && commands[2].size == GODICE_OPEN_LEDS_PACKET_SIZE);
+	assert(commands[3].time_ms == 30 && commands[3].size == GODICE_CLOSE_TOGGLE_LEDS_PACKET_SIZE);
+	assert(commands[4].time_ms == 45 && commands[5].time_ms == 60);
+	// Green until the end is a single long blink instead of open and close packets
+	const uint8_t green_flash[] = { 0x10, 1, 100, 1, 0, 255, 0, GODICE_BLINK_PARALLEL, GODICE_LEDS_BOTH };
+	assert(commands[6].time_ms == 2000 && commands[6].track == 0 && memcmp(commands[6].packet, green_flash, sizeof(green_flash)) == 0);
+
+	godice_show_command_t small[2];
+	assert(godice_show_compile(tracks, 3, small, 2, &count) == GODICE_BUFFER_TOO_SMALL);
+	const godice_show_track_t unlooped[] = { { single, 1, stepping, 4, 100, true } };
+	assert(godice_show_compile(unlooped, 1, commands, 16, &count) == GODICE_INVALID_ARGUMENT);
+	const godice_keyframe_t unordered[] = { { 20, red }, { 10, black } };
+	const godice_show_track_t invalid[] = { { single, 1, unordered, 2, 0, false } };
+	assert(godice_show_compile(invalid, 1, commands, 16, &count) == GODICE_INVALID_ARGUMENT);
+
+	assert(godice_show_compile(tracks, 3, commands, 16, &count) == GODICE_OK);
+	godice_show_player_t player;
+	godice_show_player_init(&player, tracks, commands, count, 10000, 20);
+	assert(godice_show_player_next_time(&player) == 9980);
+	uint32_t dice_id;
+	const uint8_t *packet;
+	size_t size;
+	assert(godice_show_player_next(&player, 9979, &dice_id, &packet, &size) == GODICE_LIMIT_REACHED);
+	vector<uint32_t> sent;
+	while (godice_show_player_next(&player, 9980, &dice_id, &packet, &size) == GODICE_OK) {
+		sent.push_back(dice_id);
+	}
+	assert((sent == vector<uint32_t>{ 1, 2, 3 }));
+	assert(godice_show_player_next_time(&player) == 9995);
+	sent.clear();
+	while (godice_show_player_next(&player, 20000, &dice_id, &packet, &size) == GODICE_OK) {
+		sent.push_back(dice_id);
+	}
+	assert(sent.size() == 6);
+	assert(godice_show_player_next_time(&player) == UINT64_MAX);
+}
+
+void test_pool() {
+	static godice_pool_t pool;
+	godice_pool_init(&pool);
+	godice_callbacks_t callbacks = recording_callbacks();
+	recorded_t recorded;
+
+	uint8_t roll[] = {'R'};
+	uint8_t stable_five[] = {'S', 0, 0, (uint8_t)-64};
+	assert(godice_pool_incoming_packet(&pool, &callbacks, &recorded, 5, 6, roll, sizeof(roll)) == GODICE_OK);
+	assert(godice_pool_incoming_packet(&pool, &callbacks, &recorded, 5, 6, stable_five, sizeof(stable_five)) == GODICE_OK);
+	assert(recorded.rolls == 1 && (recorded.stables == vector<int>{5}));
+	godice_pool_dice_t *dice = godice_pool_find(&pool, 5);
+	assert(dice != NULL && dice->state.calibration == &dice->calibration && dice->stats.values_num == 6);
+	assert(godice_pool_dice(&pool, 5, 20) == dice && dice->calibration.faces_num == 20);
+	assert(godice_pool_dice(&pool, 6, 7) == NULL);
+
+	for (uint32_t dice_id = 100; dice_id < 100 + GODICE_POOL_DICE - 1; dice_id++) {
+		assert(godice_pool_dice(&pool, dice_id, 6) != NULL);
+	}
+	assert(godice_pool_incoming_packet(&pool, &callbacks, &recorded, 6, 6, roll, sizeof(roll)) == GODICE_LIMIT_REACHED);
+	godice_pool_release(&pool, 100);
+	assert(godice_pool_find(&pool, 100) == NULL);
+	assert(godice_pool_incoming_packet(&pool, &callbacks, &recorded, 6, 6, roll, sizeof(roll)) == GODICE_OK);
+
+	uint8_t packet[GODICE_POOL_MAX_PACKET_SIZE];
+	size_t size;
+	assert(godice_get_color_packet(packet, sizeof(packet), &size) == GODICE_OK);
+	for (uint32_t i = 0; i < GODICE_POOL_COMMANDS; i++) {
+		assert(godice_pool_push_command(&pool, i, packet, size) == GODICE_OK);
+	}
+	assert(godice_pool_push_command(&pool, 0, packet, size) == GODICE_LIMIT_REACHED);
+	for (uint32_t i = 0; i < GODICE_POOL_COMMANDS; i++) {
+		const godice_pool_command_t *command = godice_pool_peek_command(&pool);
+		assert(command != NULL && command->dice_id == i && command->size == size && command->packet[0] == packet[0]);
+		godice_pool_pop_command(&pool);
+		if (i == 0) {
+			assert(godice_pool_push_command(&pool, GODICE_POOL_COMMANDS, packet, size) == GODICE_OK);
+		}
+	}
+	assert(godice_pool_peek_command(&pool)->dice_id == GODICE_POOL_COMMANDS);
+	godice_pool_pop_command(&pool);
+	assert(godice_pool_peek_command(&pool) == NULL);
+}
+
+static vector<uint32_t> battery_polls(godice_battery_t *battery, uint32_t now_ms) {
+	uint32_t dice_ids[GODICE_BATTERY_DICE];
+	size_t count = godice_battery_poll(battery, now_ms, dice_ids, GODICE_BATTERY_DICE);
+	vector<uint32_t> polls(dice_ids, dice_ids + count);
+	sort(polls.begin(), polls.end());
+	return polls;
+}
+
+void test_battery() {
+	static godice_battery_t battery;
+	godice_battery_settings_t settings;
+	godice_battery_settings_default(&settings);
+	godice_battery_init(&battery, &settings, 0);
+
+	// Connected dice are polled right away, unanswered polls are retried after `min_interval_ms`
+	assert(godice_battery_add(&battery, 1, 0) == GODICE_OK && godice_battery_add(&battery, 2, 0) == GODICE_OK);
+	assert((battery_polls(&battery, 0) == vector<uint32_t>{ 1, 2 }));
+	assert(battery_polls(&battery, 1000).empty());
+	assert(godice_battery_on_charge_level(&battery, 1, 100, 1000) == GODICE_OK);
+	assert(godice_battery_on_charge_level(&battery, 2, 55, 1000) == GODICE_OK);
+	assert(godice_battery_find(&battery, 1)->due_ms == 61000);
+
+	// Drain is measured from level drops, the next poll is at the predicted step crossing
+	assert(godice_battery_on_charge_level(&battery, 1, 99, 61000) == GODICE_OK);
+	const godice_battery_dice_t *dice = godice_battery_find(&battery, 1);
+	assert(dice->ms_per_percent == 60000 && dice->due_ms == 61000 + 9 * 60000);
+	// Unchanged level bounds drain: 55 is not left for 60 s, 50 is expected 5 minutes after 1000
+	assert(godice_battery_on_charge_level(&battery, 2, 55, 61000) == GODICE_OK);
+	dice = godice_battery_find(&battery, 2);
+	assert(dice->ms_per_percent == 60000 && dice->due_ms == 301000);
+	// Charging dice are polled rarely
+	assert(godice_battery_on_charging(&battery, 3, true, 2000) == GODICE_OK);
+	assert(godice_battery_find(&battery, 3)->due_ms == 2000 + settings.max_interval_ms);
+
+	// Due polls wait for a quiet period between rolls
+	godice_battery_on_roll(&battery, 300000);
+	assert(battery_polls(&battery, 301500).empty());
+	assert((battery_polls(&battery, 303500) == vector<uint32_t>{ 2 }));
+	assert(godice_battery_on_charge_level(&battery, 2, 54, 303600) == GODICE_OK);
+	assert(godice_battery_find(&battery, 2)->ms_per_percent == (60000 * 3 + 302600) / 4);
+
+	// Polls due within `batch_ms` join due ones
+	assert(godice_battery_add(&battery, 6, 590000) == GODICE_OK);
+	assert((battery_polls(&battery, 590000) == vector<uint32_t>{ 1, 6 }));
+	// Rolling holds polls back for at most `max_delay_ms`
+	godice_battery_on_roll(&battery, 700000);
+	assert(battery_polls(&battery, 700500).empty());
+	godice_battery_on_roll(&battery, 710000);
+	assert((battery_polls(&battery, 710500) == vector<uint32_t>{ 1, 6 }));
+
+	// Dice off the charger are polled for the new level
+	assert(godice_battery_on_charging(&battery, 3, false, 720000) == GODICE_OK);
+	assert((battery_polls(&battery, 720000) == vector<uint32_t>{ 3 }));
+
+	// Dice 1, 2, 3 and 6 are tracked
+	for (uint32_t dice_id = 100; dice_id < 100 + GODICE_BATTERY_DICE - 4; dice_id++) {
+		assert(godice_battery_add(&battery, dice_id, 730000) == GODICE_OK);
+	}
+	assert(godice_battery_add(&battery, 7, 730000) == GODICE_LIMIT_REACHED);
+	assert(godice_battery_on_charge_level(&battery, 7, 50, 730000) == GODICE_LIMIT_REACHED);
+	godice_battery_remove(&battery, 1);
+	assert(godice_battery_find(&battery, 1) == NULL);
+	assert(godice_battery_add(&battery, 7, 730000) == GODICE_OK);
+	uint32_t dice_ids[4];
+	assert(godice_battery_poll(&battery, 730000, dice_ids, 4) == 4);
+	assert(battery_polls(&battery, 730000).size() == GODICE_BATTERY_DICE - 3 - 4);
+
+	// Times wrap around
+	const uint32_t start = UINT32_MAX - 30000;
+	godice_battery_init(&battery, &settings, start);
+	assert(godice_battery_add(&battery, 1, start) == GODICE_OK);
+	assert((battery_polls(&battery, start) == vector<uint32_t>{ 1 }));
+	assert(godice_battery_on_charge_level(&battery, 1, 80, start) == GODICE_OK);
+	assert(battery_polls(&battery, start + 58000).empty());
+	assert((battery_polls(&battery, start + 60000) == vector<uint32_t>{ 1 }));
 }
 
 int main() {
 	test_stables();
+	test_tracked_stables();
+	test_stats();
+	test_registered_dice_type();
+	test_classification_margin();
+	test_calibration();
+	test_tuner();
+	test_events_mask();
+	test_wire();
+	test_fleet();
+	test_show();
+	test_pool();
+	test_battery();
 	return 0;
 }
@@ -0,0 +1,461 @@
+#include "godicearchive.h"
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static const char ArchiveMagic[4] = { 'G', 'D', 'A', 'R' };
+#define ARCHIVE_VERSION 1
+
+typedef struct {
+	char magic[4];
+	uint32_t version;
+	uint64_t reserved;
+} archiveHeader_t;
+
+typedef struct {
+	uint64_t index_offset;
+	uint64_t chunks;
+	uint64_t rows;
+	char magic[4];
+	uint32_t version;
+} archiveFooter_t;
+
+typedef struct {
+	uint64_t offset;
+	uint64_t first_timestamp;
+	uint64_t min_timestamp;
+	uint64_t max_timestamp;
+	uint64_t dice_filter[4];
+	uint32_t size;
+	uint32_t rows;
+	uint32_t min_dice_id;
+	uint32_t max_dice_id;
+	uint32_t events_size;
+	uint8_t timestamp_bits;
+	uint8_t dice_bits;
+	uint8_t value_bits;
+	uint8_t reserved;
+} chunkIndex_t;
+
+struct godice_archive_writer {
+	FILE *file;
+	uint64_t offset;
+	uint64_t rows_total;
+	godice_wire_event_t rows[GODICE_ARCHIVE_CHUNK_ROWS];
+	uint32_t rows_num;
+	uint64_t values[GODICE_ARCHIVE_CHUNK_ROWS];
+	uint8_t chunk[GODICE_ARCHIVE_CHUNK_ROWS * 24];
+	chunkIndex_t *index;
+	size_t index_num;
+	size_t index_capacity;
+	// First failed flush, later calls return it
+	godice_status_t error;
+};
+
+struct godice_archive {
+	const uint8_t *data;
+	size_t size;
+	const chunkIndex_t *index;
+	size_t chunks;
+	uint64_t rows;
+};
+
+static uint64_t zigzag_encode(int64_t value) {
+	return ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+}
+
+static int64_t zigzag_decode(uint64_t value) {
+	return (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+}
+
+static uint8_t bits_needed(uint64_t value) {
+	return value == 0 ? 0 : (uint8_t)(64 - __builtin_clzll(value));
+}
+
+static size_t packed_size(uint32_t rows, uint8_t bits) {
+	return ((size_t)rows * bits + 7) / 8;
+}
+
+static int dice_filter_bit(uint32_t dice_id) {
+	return (int)((dice_id * 2654435761u) >> 24);
+}
+
+static bool dice_filter_has(const uint64_t filter[4], uint32_t dice_id) {
+	int bit = dice_filter_bit(dice_id);
+	return (filter[bit / 64] >> (bit % 64)) & 1;
+}
+
+static size_t pack_bits(uint8_t *out, const uint64_t *values, uint32_t count, uint8_t bits) {
+	size_t size = packed_size(count, bits);
+	memset(out, 0, size);
+	if (bits == 0) {
+		return 0;
+	}
+	size_t bit = 0;
+	for (uint32_t i = 0; i < count; i++, bit += bits) {
+		for (uint8_t b = 0; b < bits; b++) {
+			if ((values[i] >> b) & 1) {
+				out[(bit + b) / 8] |= (uint8_t)(1u << ((bit + b) % 8));
+			}
+		}
+	}
+	return size;
+}
+
+static uint64_t unpack_bits(const uint8_t *in, uint32_t index, uint8_t bits) {
+	uint64_t value = 0;
+	size_t bit = (size_t)index * bits;
+	for (uint8_t b = 0; b < bits; b++, bit++) {
+		value |= (uint64_t)((in[bit / 8] >> (bit % 8)) & 1) << b;
+	}
+	return value;
+}
+
+static size_t write_varint(uint8_t *buffer, uint64_t value) {
+	size_t size = 0;
+	while (value >= 0x80) {
+		buffer[size++] = (uint8_t)(value | 0x80);
+		value >>= 7;
+	}
+	buffer[size++] = (uint8_t)value;
+	return size;
+}
+
+static bool read_varint(const uint8_t *buffer, size_t size, size_t *offset, uint64_t *value) {
+	uint64_t result = 0;
+	for (int shift = 0; shift < 64 && *offset < size; shift += 7) {
+		uint8_t byte = buffer[(*offset)++];
+		result |= (uint64_t)(byte & 0x7f) << shift;
+		if ((byte & 0x80) == 0) {
+			*value = result;
+			return true;
+		}
+	}
+	return false;
+}
+
+static uint8_t event_index(godice_event_t event) {
+	return (uint8_t)__builtin_ctz((uint32_t)event);
+}
+
+godice_status_t godice_archive_writer_open(godice_archive_writer_t **writer, const char *path) {
+	godice_archive_writer_t *result = calloc(1, sizeof(godice_archive_writer_t));
+	if (result == NULL) {
+		return GODICE_LIMIT_REACHED;
+	}
+	result->file = fopen(path, "wb");
+	archiveHeader_t header = { { 0 }, ARCHIVE_VERSION, 0 };
+	memcpy(header.magic, ArchiveMagic, sizeof(header.magic));
+	if (result->file == NULL || fwrite(&header, sizeof(header), 1, result->file) != 1) {
+		if (result->file != NULL) {
+			fclose(result->file);
+		}
+		free(result);
+		return GODICE_IO_ERROR;
+	}
+	result->offset = sizeof(header);
+	*writer = result;
+	return GODICE_OK;
+}
+
+static godice_status_t flush_chunk(godice_archive_writer_t *writer) {
+	uint32_t rows = writer->rows_num;
+	if (rows == 0) {
+		return GODICE_OK;
+	}
+	if (writer->index_num == writer->index_capacity) {
+		size_t capacity = writer->index_capacity == 0 ? 64 : writer->index_capacity * 2;
+		chunkIndex_t *index = realloc(writer->index, capacity * sizeof(chunkIndex_t));
+		if (index == NULL) {
+			return GODICE_LIMIT_REACHED;
+		}
+		writer->index = index;
+		writer->index_capacity = capacity;
+	}
+	chunkIndex_t *entry = &writer->index[writer->index_num];
+	memset(entry, 0, sizeof(*entry));
+	const godice_wire_event_t *events = writer->rows;
+	entry->offset = writer->offset;
+	entry->rows = rows;
+	entry->first_timestamp = events[0].timestamp_ms;
+	entry->min_timestamp = entry->max_timestamp = events[0].timestamp_ms;
+	entry->min_dice_id = entry->max_dice_id = events[0].dice_id;
+	uint8_t max_value = 0;
+	for (uint32_t i = 0; i < rows; i++) {
+		const godice_wire_event_t *event = &events[i];
+		if (event->timestamp_ms < entry->min_timestamp) entry->min_timestamp = event->timestamp_ms;
+		if (event->timestamp_ms > entry->max_timestamp) entry->max_timestamp = event->timestamp_ms;
+		if (event->dice_id < entry->min_dice_id) entry->min_dice_id = event->dice_id;
+		if (event->dice_id > entry->max_dice_id) entry->max_dice_id = event->dice_id;
+		if (event->value > max_value) max_value = event->value;
+		int bit = dice_filter_bit(event->dice_id);
+		entry->dice_filter[bit / 64] |= (uint64_t)1 << (bit % 64);
+	}
+
+	size_t size = 0;
+	uint64_t max_delta = 0;
+	for (uint32_t i = 0; i < rows; i++) {
+		int64_t delta = i == 0 ? 0 : (int64_t)(events[i].timestamp_ms - events[i - 1].timestamp_ms);
+		writer->values[i] = zigzag_encode(delta);
+		max_delta |= writer->values[i];
+	}
+	entry->timestamp_bits = bits_needed(max_delta);
+	size += pack_bits(writer->chunk + size, writer->values, rows, entry->timestamp_bits);
+
+	for (uint32_t i = 0; i < rows; i++) {
+		writer->values[i] = events[i].dice_id - entry->min_dice_id;
+	}
+	entry->dice_bits = bits_needed(entry->max_dice_id - entry->min_dice_id);
+	size += pack_bits(writer->chunk + size, writer->values, rows, entry->dice_bits);
+
+	for (uint32_t i = 0; i < rows; i++) {
+		writer->values[i] = events[i].value;
+	}
+	entry->value_bits = bits_needed(max_value);
+	size += pack_bits(writer->chunk + size, writer->values, rows, entry->value_bits);
+
+	size_t events_start = size;
+	for (uint32_t i = 0; i < rows;) {
+		uint32_t run = 1;
+		while (i + run < rows && events[i + run].event == events[i].event) {
+			run++;
+		}
+		writer->chunk[size++] = event_index(events[i].event);
+		size += write_varint(writer->chunk + size, run);
+		i += run;
+	}
+	entry->events_size = (uint32_t)(size - events_start);
+	entry->size = (uint32_t)size;
+
+	if (fwrite(writer->chunk, 1, size, writer->file) != size) {
+		return GODICE_IO_ERROR;
+	}
+	writer->offset += size;
+	writer->index_num++;
+	writer->rows_num = 0;
+	return GODICE_OK;
+}
+
+godice_status_t godice_archive_writer_add(godice_archive_writer_t *writer, const godice_wire_event_t *event) {
+	// Events column holds one event per row
+	if (event->event == GODICE_EVENT_NONE || (event->event & (event->event - 1)) != 0) {
+		return GODICE_INVALID_ARGUMENT;
+	}
+	if (writer->error != GODICE_OK) {
+		return writer->error;
+	}
+	writer->rows[writer->rows_num++] = *event;
+	writer->rows_total++;
+	if (writer->rows_num == GODICE_ARCHIVE_CHUNK_ROWS) {
+		writer->error = flush_chunk(writer);
+	}
+	return writer->error;
+}
+
+godice_status_t godice_archive_writer_close(godice_archive_writer_t *writer) {
+	godice_status_t status = writer->error != GODICE_OK ? writer->error : flush_chunk(writer);
+	if (status == GODICE_OK) {
+		archiveFooter_t footer = { writer->offset, writer->index_num, writer->rows_total, { 0 }, ARCHIVE_VERSION };
+		memcpy(footer.magic, ArchiveMagic, sizeof(footer.magic));
+		if (fwrite(writer->index, sizeof(chunkIndex_t), writer->index_num, writer->file) != writer->index_num ||
+			fwrite(&footer, sizeof(footer), 1, writer->file) != 1) {
+			status = GODICE_IO_ERROR;
+		}
+	}
+	if (fclose(writer->file) != 0 && status == GODICE_OK) {
+		status = GODICE_IO_ERROR;
+	}
+	free(writer->index);
+	free(writer);
+	return status;
+}
+
+godice_status_t godice_archive_open(godice_archive_t **archive, const char *path) {
+	int fd = open(path, O_RDONLY);
+	if (fd < 0) {
+		return GODICE_IO_ERROR;
+	}
+	struct stat st;
+	if (fstat(fd, &st) != 0) {
+		close(fd);
+		return GODICE_IO_ERROR;
+	}
+	size_t size = (size_t)st.st_size;
+	if (size < sizeof(archiveHeader_t) + sizeof(archiveFooter_t)) {
+		close(fd);
+		return GODICE_INVALID_PACKET;
+	}
+	void *data = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (data == MAP_FAILED) {
+		return GODICE_IO_ERROR;
+	}
+
+	const archiveHeader_t *header = data;
+	const archiveFooter_t *footer = (const archiveFooter_t*)((const uint8_t*)data + size - sizeof(archiveFooter_t));
+	bool valid = memcmp(header->magic, ArchiveMagic, sizeof(ArchiveMagic)) == 0 &&
+		header->version == ARCHIVE_VERSION &&
+		memcmp(footer->magic, ArchiveMagic, sizeof(ArchiveMagic)) == 0 &&
+		footer->index_offset <= size - sizeof(archiveFooter_t) &&
+		footer->chunks == (size - sizeof(archiveFooter_t) - footer->index_offset) / sizeof(chunkIndex_t);
+	const chunkIndex_t *index = (const chunkIndex_t*)((const uint8_t*)data + footer->index_offset);
+	for (uint64_t i = 0; valid && i < footer->chunks; i++) {
+		// Column widths are limited by their types: timestamp delta, dice id and value
+		valid = index[i].offset + index[i].size <= footer->index_offset && index[i].rows > 0 &&
+			index[i].timestamp_bits <= 64 && index[i].dice_bits <= 32 && index[i].value_bits <= 8;
+	}
+	godice_archive_t *result = valid ? calloc(1, sizeof(godice_archive_t)) : NULL;
+	if (result == NULL) {
+		munmap(data, size);
+		return valid ? GODICE_LIMIT_REACHED : GODICE_INVALID_PACKET;
+	}
+	madvise(data, size, MADV_RANDOM);
+	result->data = data;
+	result->size = size;
+	result->index = index;
+	result->chunks = (size_t)footer->chunks;
+	result->rows = footer->rows;
+	*archive = result;
+	return GODICE_OK;
+}
+
+void godice_archive_close(godice_archive_t *archive) {
+	munmap((void*)archive->data, archive->size);
+	free(archive);
+}
+
+uint64_t godice_archive_rows(const godice_archive_t *archive) {
+	return archive->rows;
+}
+
+size_t godice_archive_chunks(const godice_archive_t *archive) {
+	return archive->chunks;
+}
+
+static bool chunk_matches(const chunkIndex_t *entry, const godice_archive_filter_t *filter) {
+	if (entry->max_timestamp < filter->from_ms || entry->min_timestamp > filter->to_ms) {
+		return false;
+	}
+	if (filter->dice_id == GODICE_ARCHIVE_ANY_DICE) {
+		return true;
+	}
+	return filter->dice_id >= entry->min_dice_id && filter->dice_id <= entry->max_dice_id &&
+		dice_filter_has(entry->dice_filter, filter->dice_id);
+}
+
+typedef struct {
+	const godice_archive_t *archive;
+	const godice_archive_filter_t *filter;
+	godice_archive_scan_cb callback;
+	void *userdata;
+	atomic_size_t next_chunk;
+	atomic_size_t scanned_chunks;
+	atomic_int status;
+} scan_t;
+
+typedef struct {
+	scan_t *scan;
+	int thread;
+} scanWorker_t;
+
+static godice_status_t scan_chunk(scan_t *scan, int thread, const chunkIndex_t *entry) {
+	const uint8_t *data = scan->archive->data + entry->offset;
+	const uint8_t *timestamps = data;
+	const uint8_t *dice = timestamps + packed_size(entry->rows, entry->timestamp_bits);
+	const uint8_t *values = dice + packed_size(entry->rows, entry->dice_bits);
+	const uint8_t *events = values + packed_size(entry->rows, entry->value_bits);
+	if ((size_t)(events - data) + entry->events_size != entry->size) {
+		return GODICE_INVALID_PACKET;
+	}
+	const godice_archive_filter_t *filter = scan->filter;
+	size_t events_offset = 0;
+	uint64_t run_left = 0;
+	godice_wire_event_t event;
+	event.timestamp_ms = entry->first_timestamp;
+	for (uint32_t row = 0; row < entry->rows; row++, run_left--) {
+		if (run_left == 0) {
+			if (events_offset >= entry->events_size || events[events_offset] >= 32) {
+				return GODICE_INVALID_PACKET;
+			}
+			event.event = (godice_event_t)((uint32_t)1 << events[events_offset++]);
+			if (!read_varint(events, entry->events_size, &events_offset, &run_left) || run_left == 0) {
+				return GODICE_INVALID_PACKET;
+			}
+		}
+		if (row > 0) {
+			event.timestamp_ms += (uint64_t)zigzag_decode(unpack_bits(timestamps, row, entry->timestamp_bits));
+		}
+		if (event.timestamp_ms < filter->from_ms || event.timestamp_ms > filter->to_ms) {
+			continue;
+		}
+		event.dice_id = entry->min_dice_id + (uint32_t)unpack_bits(dice, row, entry->dice_bits);
+		if (filter->dice_id != GODICE_ARCHIVE_ANY_DICE && event.dice_id != filter->dice_id) {
+			continue;
+		}
+		event.value = (uint8_t)unpack_bits(values, row, entry->value_bits);
+		scan->callback(scan->userdata, thread, &event);
+	}
+	return GODICE_OK;
+}
+
+static void *scan_worker(void *arg) {
+	scanWorker_t *worker = arg;
+	scan_t *scan = worker->scan;
+	for (size_t chunk = scan->next_chunk++; chunk < scan->archive->chunks; chunk = scan->next_chunk++) {
+		const chunkIndex_t *entry = &scan->archive->index[chunk];
+		if (!chunk_matches(entry, scan->filter)) {
+			continue;
+		}
+		scan->scanned_chunks++;
+		godice_status_t status = scan_chunk(scan, worker->thread, entry);
+		if (status != GODICE_OK) {
+			scan->status = status;
+		}
+	}
+	return NULL;
+}
+
+godice_status_t godice_archive_scan(const godice_archive_t *archive, const godice_archive_filter_t *filter,
+									int threads, godice_archive_scan_cb callback, void *userdata,
+									size_t *scanned_chunks) {
+	if (threads <= 0) {
+		long cores = sysconf(_SC_NPROCESSORS_ONLN);
+		threads = cores > 0 ? (int)cores : 1;
+	}
+	scan_t scan = { archive, filter, callback, userdata, 0, 0, GODICE_OK };
+	scanWorker_t *workers = calloc((size_t)threads, sizeof(scanWorker_t));
+	pthread_t *handles = calloc((size_t)threads, sizeof(pthread_t));
+	if (workers == NULL || handles == NULL) {
+		free(workers);
+		free(handles);
+		return GODICE_LIMIT_REACHED;
+	}
+	// Threads that failed to start leave their share to the others
+	int started = 0;
+	for (int i = 0; i < threads; i++) {
+		workers[i].scan = &scan;
+		workers[i].thread = i;
+		if (i > 0) {
+			if (pthread_create(&handles[i], NULL, scan_worker, &workers[i]) != 0) {
+				break;
+			}
+			started = i;
+		}
+	}
+	scan_worker(&workers[0]);
+	for (int i = 1; i <= started; i++) {
+		pthread_join(handles[i], NULL);
+	}
+	free(workers);
+	free(handles);
+	if (scanned_chunks != NULL) {
+		*scanned_chunks = scan.scanned_chunks;
+	}
+	return (godice_status_t)scan.status;
+}
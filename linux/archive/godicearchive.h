@@ -0,0 +1,58 @@
+#ifndef __GODICESDK_GODICEARCHIVE_H
+#define __GODICESDK_GODICEARCHIVE_H
+
+#include "godicewire.h"
+
+// Long-term archive of decoded events.
+//
+// Events are stored in chunks of up to GODICE_ARCHIVE_CHUNK_ROWS rows. Each chunk keeps its
+// columns separately: timestamps as zigzag deltas and dice ids relative to the chunk minimum
+// (both bit-packed), event kinds run-length encoded and values bit-packed. The chunk index at
+// the end of the file holds time and dice id ranges plus a dice id filter of every chunk, so
+// scans skip chunks without touching their data. Files are read through mmap and use host
+// byte order (little endian on all supported hosts).
+
+#define GODICE_ARCHIVE_CHUNK_ROWS 65536
+#define GODICE_ARCHIVE_ANY_DICE UINT32_MAX
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct godice_archive_writer godice_archive_writer_t;
+typedef struct godice_archive godice_archive_t;
+
+typedef struct {
+	// `GODICE_ARCHIVE_ANY_DICE` matches all dice
+	uint32_t dice_id;
+	// Inclusive time range
+	uint64_t from_ms;
+	uint64_t to_ms;
+} godice_archive_filter_t;
+
+// Called for every matching event, concurrently from `thread` 0 .. threads - 1
+typedef void (*godice_archive_scan_cb)(void *userdata, int thread, const godice_wire_event_t *event);
+
+godice_status_t godice_archive_writer_open(godice_archive_writer_t **writer, const char *path);
+// Returns GODICE_INVALID_ARGUMENT unless `event->event` is a single event flag. After a failed
+// chunk write every call returns its error, the archive is incomplete and should be closed.
+godice_status_t godice_archive_writer_add(godice_archive_writer_t *writer, const godice_wire_event_t *event);
+// Flushes buffered rows, writes chunk index and frees the writer, also after errors
+godice_status_t godice_archive_writer_close(godice_archive_writer_t *writer);
+
+// Returns GODICE_INVALID_PACKET for files that are not archives or have corrupted chunk index
+godice_status_t godice_archive_open(godice_archive_t **archive, const char *path);
+void godice_archive_close(godice_archive_t *archive);
+uint64_t godice_archive_rows(const godice_archive_t *archive);
+size_t godice_archive_chunks(const godice_archive_t *archive);
+// Decodes chunks that may contain matching events on `threads` threads (0 - one per core).
+// Stores number of chunks decoded in `scanned_chunks` if not NULL.
+godice_status_t godice_archive_scan(const godice_archive_t *archive, const godice_archive_filter_t *filter,
+									int threads, godice_archive_scan_cb callback, void *userdata,
+									size_t *scanned_chunks);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __GODICESDK_GODICEARCHIVE_H
@@ -0,0 +1,138 @@
+// Stand-in for a BLE bridge: connects to the gateway sources socket, reports rolls of
+// simulated D6 dice and answers color and charge level requests.
+
+#include "frame.h"
+#include <getopt.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+static const int8_t D6Faces[6][3] = {
+	{ -64, 0, 0 }, { 0, 0, 64 }, { 0, 64, 0 }, { 0, -64, 0 }, { 0, 0, -64 }, { 64, 0, 0 },
+};
+
+static int send_frame(int fd, uint32_t dice_id, const uint8_t *packet, size_t size) {
+	uint8_t buffer[FRAME_MAX_SIZE];
+	frame_t frame = { FRAME_NOTIFY, dice_id, 6, packet, size };
+	size_t frame_size = frame_write(buffer, sizeof(buffer), &frame);
+	return write(fd, buffer, frame_size) == (ssize_t)frame_size ? 0 : -1;
+}
+
+// Rolls `face` (1 to 6) or a random face if 0
+static int roll(int fd, uint32_t dice_id, int face_value) {
+	const uint8_t roll_packet[] = { 'R' };
+	const int8_t *face = D6Faces[face_value > 0 ? face_value - 1 : rand() % 6];
+	const uint8_t stable_packet[] = { 'S', (uint8_t)face[0], (uint8_t)face[1], (uint8_t)face[2] };
+	if (send_frame(fd, dice_id, roll_packet, sizeof(roll_packet)) != 0) {
+		return -1;
+	}
+	return send_frame(fd, dice_id, stable_packet, sizeof(stable_packet));
+}
+
+static int incoming_write(int fd, const frame_t *frame) {
+	printf("write %u:", frame->dice_id);
+	for (size_t i = 0; i < frame->packet_size; i++) {
+		printf(" %02x", frame->packet[i]);
+	}
+	printf("\n");
+	fflush(stdout);
+	if (frame->packet_size != 1) {
+		return 0;
+	}
+	if (frame->packet[0] == 0x17) {
+		const uint8_t color_packet[] = { 'C', 'o', 'l', (uint8_t)(frame->dice_id % 6) };
+		return send_frame(fd, frame->dice_id, color_packet, sizeof(color_packet));
+	}
+	if (frame->packet[0] == 0x03) {
+		const uint8_t battery_packet[] = { 'B', 'a', 't', 87 };
+		return send_frame(fd, frame->dice_id, battery_packet, sizeof(battery_packet));
+	}
+	return 0;
+}
+
+int main(int argc, char **argv) {
+	const char *sources_path = "/tmp/godice-sources.sock";
+	int dice_num = 4;
+	int rolls = -1;
+	int interval_ms = 1000;
+	int face = 0;
+	static const struct option options[] = {
+		{ "sources", required_argument, NULL, 's' },
+		{ "dice", required_argument, NULL, 'd' },
+		{ "rolls", required_argument, NULL, 'n' },
+		{ "interval", required_argument, NULL, 'i' },
+		{ "face", required_argument, NULL, 'f' },
+		{ NULL, 0, NULL, 0 },
+	};
+	int option;
+	while ((option = getopt_long(argc, argv, "s:d:n:i:f:", options, NULL)) != -1) {
+		switch (option) {
+			case 's': sources_path = optarg; break;
+			case 'd': dice_num = atoi(optarg); break;
+			case 'n': rolls = atoi(optarg); break;
+			case 'i': interval_ms = atoi(optarg); break;
+			case 'f': face = atoi(optarg); break;
+			default:
+				fprintf(stderr, "usage: godice-fakedice [--sources PATH] [--dice N] [--rolls N] [--interval MS] [--face 1-6]\n");
+				return EXIT_FAILURE;
+		}
+	}
+	if (face < 0 || face > 6) {
+		fprintf(stderr, "godice-fakedice: face must be 1 to 6\n");
+		return EXIT_FAILURE;
+	}
+
+	int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	struct sockaddr_un address = { .sun_family = AF_UNIX };
+	strncpy(address.sun_path, sources_path, sizeof(address.sun_path) - 1);
+	if (fd < 0 || connect(fd, (struct sockaddr*)&address, sizeof(address)) != 0) {
+		perror("godice-fakedice: connect");
+		return EXIT_FAILURE;
+	}
+
+	uint8_t in[1024];
+	size_t in_size = 0;
+	uint32_t next_dice = 0;
+	while (rolls != 0) {
+		struct pollfd poll_fd = { .fd = fd, .events = POLLIN };
+		int ready = poll(&poll_fd, 1, interval_ms);
+		if (ready < 0) {
+			break;
+		}
+		if (ready == 0) {
+			if (roll(fd, next_dice, face) != 0) {
+				break;
+			}
+			next_dice = (next_dice + 1) % (uint32_t)dice_num;
+			if (rolls > 0) {
+				rolls--;
+			}
+			continue;
+		}
+		ssize_t result = read(fd, in + in_size, sizeof(in) - in_size);
+		if (result <= 0) {
+			break;
+		}
+		in_size += (size_t)result;
+		size_t offset = 0;
+		frame_t frame;
+		int size;
+		while ((size = frame_parse(in + offset, in_size - offset, &frame)) > 0) {
+			if (frame.type == FRAME_WRITE && incoming_write(fd, &frame) != 0) {
+				break;
+			}
+			offset += (size_t)size;
+		}
+		if (size < 0) {
+			break;
+		}
+		memmove(in, in + offset, in_size - offset);
+		in_size -= offset;
+	}
+	close(fd);
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,55 @@
+#include "frame.h"
+#include <string.h>
+
+static size_t frame_fields_size(frame_type_t type) {
+	return type == FRAME_NOTIFY ? 6 : 5;
+}
+
+int frame_parse(const uint8_t *buffer, size_t size, frame_t *frame) {
+	if (size < FRAME_HEADER_SIZE) {
+		return 0;
+	}
+	size_t length = buffer[0] | (buffer[1] << 8);
+	if (length < 1 || length > FRAME_MAX_SIZE - FRAME_HEADER_SIZE) {
+		return -1;
+	}
+	if (size < FRAME_HEADER_SIZE + length) {
+		return 0;
+	}
+	const uint8_t *body = buffer + FRAME_HEADER_SIZE;
+	if (body[0] != FRAME_NOTIFY && body[0] != FRAME_WRITE) {
+		return -1;
+	}
+	frame->type = (frame_type_t)body[0];
+	size_t fields_size = frame_fields_size(frame->type);
+	if (length < fields_size) {
+		return -1;
+	}
+	frame->dice_id = (uint32_t)body[1] | ((uint32_t)body[2] << 8) |
+		((uint32_t)body[3] << 16) | ((uint32_t)body[4] << 24);
+	frame->dice_max = frame->type == FRAME_NOTIFY ? body[5] : 0;
+	frame->packet = body + fields_size;
+	frame->packet_size = length - fields_size;
+	return (int)(FRAME_HEADER_SIZE + length);
+}
+
+size_t frame_write(uint8_t *buffer, size_t size, const frame_t *frame) {
+	size_t fields_size = frame_fields_size(frame->type);
+	size_t length = fields_size + frame->packet_size;
+	if (frame->packet_size > FRAME_MAX_PACKET_SIZE || size < FRAME_HEADER_SIZE + length) {
+		return 0;
+	}
+	buffer[0] = (uint8_t)(length & 0xff);
+	buffer[1] = (uint8_t)(length >> 8);
+	uint8_t *body = buffer + FRAME_HEADER_SIZE;
+	body[0] = (uint8_t)frame->type;
+	body[1] = (uint8_t)(frame->dice_id & 0xff);
+	body[2] = (uint8_t)((frame->dice_id >> 8) & 0xff);
+	body[3] = (uint8_t)((frame->dice_id >> 16) & 0xff);
+	body[4] = (uint8_t)(frame->dice_id >> 24);
+	if (frame->type == FRAME_NOTIFY) {
+		body[5] = frame->dice_max;
+	}
+	memcpy(body + fields_size, frame->packet, frame->packet_size);
+	return FRAME_HEADER_SIZE + length;
+}
@@ -0,0 +1,48 @@
+#ifndef __GODICESDK_GATEWAY_FRAME_H
+#define __GODICESDK_GATEWAY_FRAME_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+// Frames exchanged with dice sources (BLE bridges, stand-ins and capture replays):
+//   uint16 length (little endian, counts bytes after the length field)
+//   uint8  type
+//   uint32 dice id (little endian)
+//   uint8  dice type (`dice_max`), FRAME_NOTIFY only
+//   packet bytes as read from / written to the dice characteristic
+
+#define FRAME_HEADER_SIZE 2
+#define FRAME_MAX_PACKET_SIZE 64
+#define FRAME_MAX_SIZE (FRAME_HEADER_SIZE + 6 + FRAME_MAX_PACKET_SIZE)
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+	// Source -> gateway, value received from dice `read characteristic`
+	FRAME_NOTIFY = 1,
+	// Gateway -> source, value to write to dice `write characteristic`
+	FRAME_WRITE = 2,
+} frame_type_t;
+
+typedef struct {
+	frame_type_t type;
+	uint32_t dice_id;
+	uint8_t dice_max;
+	const uint8_t *packet;
+	size_t packet_size;
+} frame_t;
+
+// Parses a frame from the start of `buffer`. Returns frame size, 0 if more data is needed
+// or -1 if data is malformed.
+int frame_parse(const uint8_t *buffer, size_t size, frame_t *frame);
+// Returns written frame size or 0 if `buffer` is too small
+size_t frame_write(uint8_t *buffer, size_t size, const frame_t *frame);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __GODICESDK_GATEWAY_FRAME_H
@@ -0,0 +1,741 @@
+#include "frame.h"
+#include "godiceapi.h"
+#include "godicestore.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <signal.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#define countof(array) (sizeof(array) / sizeof(array[0]))
+
+#define GATEWAY_MAX_CONNECTIONS 256
+// Power of two, dice are kept in an open addressing table
+#define GATEWAY_MAX_DICE 1024
+#define GATEWAY_IN_BUFFER_SIZE 4096
+#define GATEWAY_OUT_BUFFER_SIZE 16384
+#define GATEWAY_MAX_EVENTS 64
+#define GATEWAY_MAX_LINE 128
+
+#define GATEWAY_ALL_EVENTS ((uint32_t)(GODICE_EVENT_COLOR << 1) - 1)
+// Decoded even without subscribers when state is persisted
+#define GATEWAY_STORED_EVENTS (GODICE_EVENT_COLOR | GODICE_EVENT_BATTERY | GODICE_EVENT_CHARGING)
+// Dice capacity of newly created state files
+#define GATEWAY_STORE_CAPACITY 4096
+
+typedef enum {
+	CONNECTION_FREE = 0,
+	CONNECTION_SOURCES_LISTENER,
+	CONNECTION_SUBSCRIBERS_LISTENER,
+	// Dice source accepting writes: BLE bridge or stand-in
+	CONNECTION_SOURCE,
+	// Read-only dice source: capture file or pipe
+	CONNECTION_REPLAY,
+	CONNECTION_SUBSCRIBER,
+} connection_kind_t;
+
+typedef struct {
+	connection_kind_t kind;
+	int fd;
+	// Regular files can't be polled and are read on every loop iteration instead
+	bool pollable;
+	uint32_t polled_events;
+	uint8_t in[GATEWAY_IN_BUFFER_SIZE];
+	size_t in_size;
+	uint8_t out[GATEWAY_OUT_BUFFER_SIZE];
+	size_t out_size;
+	// Subscribers only: events to publish and events dropped because `out` was full
+	uint32_t events_mask;
+	uint64_t dropped;
+} connection_t;
+
+typedef struct {
+	bool used;
+	uint32_t dice_id;
+	// Source that last reported this dice, commands are routed to it
+	connection_t *source;
+	godice_dice_state_t state;
+	// Dice type was saved to state store
+	bool type_stored;
+	uint8_t dice_type;
+	// Stale stored state was requested from dice
+	bool revalidated;
+} dice_t;
+
+typedef struct {
+	int epoll_fd;
+	int unpolled_num;
+	bool paused;
+	// Union of subscriber masks, decoder mask also has stored events and rolls
+	uint32_t subscribed_events;
+	godice_store_t *store;
+	godice_callbacks_t callbacks;
+	connection_t connections[GATEWAY_MAX_CONNECTIONS];
+	dice_t dice[GATEWAY_MAX_DICE];
+} gateway_t;
+
+static gateway_t g_gateway;
+static volatile sig_atomic_t g_stop = 0;
+
+static const struct {
+	const char *name;
+	uint32_t events;
+} EventNames[] = {
+	{ "roll", GODICE_EVENT_ROLL },
+	{ "stable", GODICE_EVENTS_STABLE_ALL },
+	{ "tap", GODICE_EVENT_TAP },
+	{ "double-tap", GODICE_EVENT_DOUBLE_TAP },
+	{ "battery", GODICE_EVENT_BATTERY },
+	{ "charging", GODICE_EVENT_CHARGING },
+	{ "color", GODICE_EVENT_COLOR },
+	{ "all", GATEWAY_ALL_EVENTS },
+};
+
+static const char *StableKindNames[] = { "S", "FS", "MS", "TS" };
+static const godice_event_t StableKindEvents[] = {
+	GODICE_EVENT_STABLE, GODICE_EVENT_FAKE_STABLE, GODICE_EVENT_MOVE_STABLE, GODICE_EVENT_TILT_STABLE,
+};
+
+static void on_signal(int signal) {
+	(void)signal;
+	g_stop = 1;
+}
+
+static bool is_congested(const connection_t *connection) {
+	return connection->out_size > sizeof(connection->out) / 2;
+}
+
+// Replays are read only while somebody listens and every subscriber keeps up,
+// so no replayed event is lost
+static bool replays_paused(const gateway_t *gateway) {
+	if (gateway->subscribed_events == 0) {
+		return true;
+	}
+	for (size_t i = 0; i < countof(gateway->connections); i++) {
+		const connection_t *connection = &gateway->connections[i];
+		if (connection->kind == CONNECTION_SUBSCRIBER && is_congested(connection)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+static void update_polling(gateway_t *gateway, connection_t *connection) {
+	if (!connection->pollable) {
+		return;
+	}
+	uint32_t events = EPOLLIN;
+	// Stop reading commands from subscribers that don't read replies
+	if (connection->kind == CONNECTION_SUBSCRIBER && is_congested(connection)) {
+		events = 0;
+	}
+	if (connection->kind == CONNECTION_REPLAY && gateway->paused) {
+		events = 0;
+	}
+	if (connection->out_size > 0) {
+		events |= EPOLLOUT;
+	}
+	if (events == connection->polled_events) {
+		return;
+	}
+	struct epoll_event event = { .events = events, .data.ptr = connection };
+	epoll_ctl(gateway->epoll_fd, EPOLL_CTL_MOD, connection->fd, &event);
+	connection->polled_events = events;
+}
+
+static connection_t *add_connection(gateway_t *gateway, int fd, connection_kind_t kind) {
+	for (size_t i = 0; i < countof(gateway->connections); i++) {
+		connection_t *connection = &gateway->connections[i];
+		if (connection->kind != CONNECTION_FREE) {
+			continue;
+		}
+		fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+		memset(connection, 0, sizeof(*connection));
+		connection->kind = kind;
+		connection->fd = fd;
+		connection->events_mask = GATEWAY_ALL_EVENTS;
+		struct epoll_event event = { .events = EPOLLIN, .data.ptr = connection };
+		if (epoll_ctl(gateway->epoll_fd, EPOLL_CTL_ADD, fd, &event) == 0) {
+			connection->pollable = true;
+			connection->polled_events = EPOLLIN;
+		} else if (errno == EPERM) {
+			gateway->unpolled_num++;
+		} else {
+			connection->kind = CONNECTION_FREE;
+			return NULL;
+		}
+		return connection;
+	}
+	return NULL;
+}
+
+static void update_events_mask(gateway_t *gateway) {
+	uint32_t events_mask = 0;
+	for (size_t i = 0; i < countof(gateway->connections); i++) {
+		if (gateway->connections[i].kind == CONNECTION_SUBSCRIBER) {
+			events_mask |= gateway->connections[i].events_mask;
+		}
+	}
+	gateway->subscribed_events = events_mask;
+	events_mask |= gateway->store != NULL ? GATEWAY_STORED_EVENTS : 0;
+	// Rolls are always decoded, tracked state needs them to report the same face again.
+	// Subscribers get only their events from `publish`.
+	gateway->callbacks.events_mask = events_mask != 0 ? events_mask | GODICE_EVENT_ROLL : 0;
+}
+
+static void close_connection(gateway_t *gateway, connection_t *connection) {
+	if (connection->pollable) {
+		epoll_ctl(gateway->epoll_fd, EPOLL_CTL_DEL, connection->fd, NULL);
+	} else {
+		gateway->unpolled_num--;
+	}
+	close(connection->fd);
+	for (size_t i = 0; i < countof(gateway->dice); i++) {
+		if (gateway->dice[i].source == connection) {
+			gateway->dice[i].source = NULL;
+		}
+	}
+	connection_kind_t kind = connection->kind;
+	connection->kind = CONNECTION_FREE;
+	if (kind == CONNECTION_SUBSCRIBER) {
+		update_events_mask(gateway);
+	}
+}
+
+static bool flush_connection(connection_t *connection) {
+	size_t written = 0;
+	while (written < connection->out_size) {
+		ssize_t result = write(connection->fd, connection->out + written, connection->out_size - written);
+		if (result < 0) {
+			if (errno == EAGAIN || errno == EWOULDBLOCK) {
+				break;
+			}
+			if (errno == EINTR) {
+				continue;
+			}
+			return false;
+		}
+		written += (size_t)result;
+	}
+	memmove(connection->out, connection->out + written, connection->out_size - written);
+	connection->out_size -= written;
+	return true;
+}
+
+// Queues data for sending. Returns false without queueing anything if there is no room.
+static bool send_data(gateway_t *gateway, connection_t *connection, const void *data, size_t size) {
+	if (sizeof(connection->out) - connection->out_size < size) {
+		return false;
+	}
+	memcpy(connection->out + connection->out_size, data, size);
+	connection->out_size += size;
+	update_polling(gateway, connection);
+	return true;
+}
+
+static bool send_line(gateway_t *gateway, connection_t *connection, const char *format, ...) {
+	char line[GATEWAY_MAX_LINE];
+	va_list args;
+	va_start(args, format);
+	int size = vsnprintf(line, sizeof(line), format, args);
+	va_end(args);
+	if (size < 0 || size >= (int)sizeof(line)) {
+		return false;
+	}
+	return send_data(gateway, connection, line, (size_t)size);
+}
+
+static void publish(gateway_t *gateway, uint32_t event, const char *format, ...) {
+	char line[GATEWAY_MAX_LINE];
+	va_list args;
+	va_start(args, format);
+	int size = vsnprintf(line, sizeof(line), format, args);
+	va_end(args);
+	if (size < 0 || size >= (int)sizeof(line)) {
+		return;
+	}
+	for (size_t i = 0; i < countof(gateway->connections); i++) {
+		connection_t *connection = &gateway->connections[i];
+		if (connection->kind != CONNECTION_SUBSCRIBER || (connection->events_mask & event) == 0) {
+			continue;
+		}
+		// Slow subscribers lose events instead of stalling decoding for everybody
+		if (!send_data(gateway, connection, line, (size_t)size)) {
+			connection->dropped++;
+		}
+	}
+}
+
+static void store_update(gateway_t *gateway, uint32_t fields, const godice_store_record_t *values) {
+	if (gateway->store != NULL && godice_store_update(gateway->store, fields, values) != GODICE_OK) {
+		fprintf(stderr, "godice-gateway: state store is full\n");
+	}
+}
+
+static void on_dice_color(void *userdata, int dice_id, godice_color_t color) {
+	godice_store_record_t values = { .dice_id = (uint32_t)dice_id, .color = (int32_t)color };
+	store_update(userdata, GODICE_STORE_COLOR, &values);
+	publish(userdata, GODICE_EVENT_COLOR, "color %u %d\n", (uint32_t)dice_id, (int)color);
+}
+
+static void on_dice_stable_kind(void *userdata, int dice_id, uint8_t number, godice_stable_kind_t kind) {
+	publish(userdata, StableKindEvents[kind], "stable %u %u %s\n",
+			(uint32_t)dice_id, (unsigned)number, StableKindNames[kind]);
+}
+
+static void on_charging_state_changed(void *userdata, int dice_id, bool charging) {
+	godice_store_record_t values = { .dice_id = (uint32_t)dice_id, .charging = charging };
+	store_update(userdata, GODICE_STORE_CHARGING, &values);
+	publish(userdata, GODICE_EVENT_CHARGING, "charging %u %d\n", (uint32_t)dice_id, charging ? 1 : 0);
+}
+
+static void on_charge_level(void *userdata, int dice_id, uint8_t level) {
+	godice_store_record_t values = { .dice_id = (uint32_t)dice_id, .charge_level = level };
+	store_update(userdata, GODICE_STORE_CHARGE_LEVEL, &values);
+	publish(userdata, GODICE_EVENT_BATTERY, "battery %u %u\n", (uint32_t)dice_id, (unsigned)level);
+}
+
+static void on_dice_roll(void *userdata, int dice_id) {
+	publish(userdata, GODICE_EVENT_ROLL, "roll %u\n", (uint32_t)dice_id);
+}
+
+static void on_dice_tap(void *userdata, int dice_id) {
+	publish(userdata, GODICE_EVENT_TAP, "tap %u\n", (uint32_t)dice_id);
+}
+
+static void on_dice_double_tap(void *userdata, int dice_id) {
+	publish(userdata, GODICE_EVENT_DOUBLE_TAP, "double-tap %u\n", (uint32_t)dice_id);
+}
+
+static dice_t *find_dice(gateway_t *gateway, uint32_t dice_id, bool create) {
+	uint32_t mask = countof(gateway->dice) - 1;
+	for (uint32_t i = 0, index = (dice_id * 2654435761u) & mask; i < countof(gateway->dice); i++, index = (index + 1) & mask) {
+		dice_t *dice = &gateway->dice[index];
+		if (dice->used && dice->dice_id == dice_id) {
+			return dice;
+		}
+		if (!dice->used) {
+			if (!create) {
+				return NULL;
+			}
+			dice->used = true;
+			dice->dice_id = dice_id;
+			dice->source = NULL;
+			dice->type_stored = false;
+			dice->revalidated = false;
+			godice_dice_state_reset(&dice->state);
+			return dice;
+		}
+	}
+	return NULL;
+}
+
+static bool parse_dice_id(const char *text, uint32_t *dice_id) {
+	char *end;
+	unsigned long value = strtoul(text, &end, 10);
+	if (end == text || *end != '\0' || value > UINT32_MAX) {
+		return false;
+	}
+	*dice_id = (uint32_t)value;
+	return true;
+}
+
+static const char *route_command(gateway_t *gateway, uint32_t dice_id, const uint8_t *packet, size_t size) {
+	dice_t *dice = find_dice(gateway, dice_id, false);
+	if (dice == NULL || dice->source == NULL) {
+		return "unknown-dice";
+	}
+	if (dice->source->kind != CONNECTION_SOURCE) {
+		return "read-only";
+	}
+	uint8_t buffer[FRAME_MAX_SIZE];
+	frame_t frame = { FRAME_WRITE, dice_id, 0, packet, size };
+	size_t frame_size = frame_write(buffer, sizeof(buffer), &frame);
+	if (!send_data(gateway, dice->source, buffer, frame_size)) {
+		return "busy";
+	}
+	return NULL;
+}
+
+// Stored color and charge level are served right after restart and requested again
+// once the dice reports through a source that accepts commands. Retried on next frame if busy.
+static void revalidate_dice(gateway_t *gateway, dice_t *dice) {
+	if (gateway->store == NULL || dice->revalidated || dice->source->kind != CONNECTION_SOURCE) {
+		return;
+	}
+	uint32_t stale = godice_store_stale(gateway->store, dice->dice_id);
+	uint8_t packet[FRAME_MAX_PACKET_SIZE];
+	size_t size;
+	bool sent = true;
+	if ((stale & GODICE_STORE_COLOR) && godice_get_color_packet(packet, sizeof(packet), &size) == GODICE_OK) {
+		sent = route_command(gateway, dice->dice_id, packet, size) == NULL;
+	}
+	if ((stale & GODICE_STORE_CHARGE_LEVEL) && godice_get_charge_level_packet(packet, sizeof(packet), &size) == GODICE_OK) {
+		sent = route_command(gateway, dice->dice_id, packet, size) == NULL && sent;
+	}
+	dice->revalidated = sent;
+}
+
+static void incoming_frame(gateway_t *gateway, connection_t *connection, const frame_t *frame) {
+	if (frame->type != FRAME_NOTIFY) {
+		return;
+	}
+	dice_t *dice = find_dice(gateway, frame->dice_id, true);
+	if (dice != NULL) {
+		dice->source = connection;
+		if (gateway->store != NULL && (!dice->type_stored || dice->dice_type != frame->dice_max)) {
+			godice_store_record_t values = { .dice_id = frame->dice_id, .dice_type = frame->dice_max };
+			store_update(gateway, GODICE_STORE_DICE_TYPE, &values);
+			dice->dice_type = frame->dice_max;
+			dice->type_stored = true;
+		}
+		revalidate_dice(gateway, dice);
+	}
+	// No subscribers, nothing to decode
+	if (gateway->callbacks.events_mask == 0) {
+		return;
+	}
+	godice_incoming_packet_tracked(&gateway->callbacks, gateway, dice == NULL ? NULL : &dice->state,
+								   (int)frame->dice_id, frame->dice_max,
+								   frame->packet, frame->packet_size);
+}
+
+static bool incoming_source_data(gateway_t *gateway, connection_t *connection) {
+	size_t offset = 0;
+	while (offset < connection->in_size) {
+		frame_t frame;
+		int size = frame_parse(connection->in + offset, connection->in_size - offset, &frame);
+		if (size < 0) {
+			return false;
+		}
+		if (size == 0) {
+			break;
+		}
+		incoming_frame(gateway, connection, &frame);
+		offset += (size_t)size;
+	}
+	memmove(connection->in, connection->in + offset, connection->in_size - offset);
+	connection->in_size -= offset;
+	return true;
+}
+
+static const char *state_command(gateway_t *gateway, connection_t *connection, uint32_t dice_id) {
+	godice_store_record_t record;
+	if (gateway->store == NULL) {
+		return "no-state";
+	}
+	if (godice_store_get(gateway->store, dice_id, &record) != GODICE_OK) {
+		return "unknown-dice";
+	}
+	char color[16] = "-", level[16] = "-", charging[16] = "-";
+	const char *type = "-";
+	if (record.fields & GODICE_STORE_COLOR) {
+		snprintf(color, sizeof(color), "%d", (int)record.color);
+	}
+	if (record.fields & GODICE_STORE_CHARGE_LEVEL) {
+		snprintf(level, sizeof(level), "%u", (unsigned)record.charge_level);
+	}
+	if (record.fields & GODICE_STORE_CHARGING) {
+		snprintf(charging, sizeof(charging), "%d", record.charging ? 1 : 0);
+	}
+	if (record.fields & GODICE_STORE_DICE_TYPE) {
+		type = godice_dice_type_name(record.dice_type);
+		type = type != NULL ? type : "?";
+	}
+	bool stale = godice_store_stale(gateway->store, dice_id) != 0;
+	if (!send_line(gateway, connection, "state %u %s %s %s %s %s\n", dice_id, color, level, charging, type,
+				   stale ? "stale" : "fresh")) {
+		return "busy";
+	}
+	return NULL;
+}
+
+static const char *subscriber_command(gateway_t *gateway, connection_t *connection, char *line) {
+	char *args[8];
+	size_t args_num = 0;
+	for (char *save, *token = strtok_r(line, " \t\r", &save);
+		 token != NULL && args_num < countof(args);
+		 token = strtok_r(NULL, " \t\r", &save)) {
+		args[args_num++] = token;
+	}
+	if (args_num == 0) {
+		return "syntax";
+	}
+
+	if (strcmp(args[0], "events") == 0 && args_num == 2) {
+		uint32_t events_mask = 0;
+		for (char *save, *name = strtok_r(args[1], ",", &save); name != NULL; name = strtok_r(NULL, ",", &save)) {
+			size_t i = 0;
+			while (i < countof(EventNames) && strcmp(EventNames[i].name, name) != 0) {
+				i++;
+			}
+			if (i == countof(EventNames)) {
+				return "unknown-event";
+			}
+			events_mask |= EventNames[i].events;
+		}
+		connection->events_mask = events_mask;
+		update_events_mask(gateway);
+		return NULL;
+	}
+
+	uint32_t dice_id;
+	if (args_num < 2 || !parse_dice_id(args[1], &dice_id)) {
+		return "syntax";
+	}
+	if (strcmp(args[0], "state") == 0 && args_num == 2) {
+		return state_command(gateway, connection, dice_id);
+	}
+	uint8_t packet[FRAME_MAX_PACKET_SIZE];
+	size_t size;
+	godice_status_t status;
+	if (strcmp(args[0], "get-color") == 0 && args_num == 2) {
+		status = godice_get_color_packet(packet, sizeof(packet), &size);
+	} else if (strcmp(args[0], "get-battery") == 0 && args_num == 2) {
+		status = godice_get_charge_level_packet(packet, sizeof(packet), &size);
+	} else if (strcmp(args[0], "leds-off") == 0 && args_num == 2) {
+		status = godice_close_toggle_leds_packet(packet, sizeof(packet), &size);
+	} else if (strcmp(args[0], "leds") == 0 && args_num == 8) {
+		uint8_t colors[6];
+		for (int i = 0; i < 6; i++) {
+			colors[i] = (uint8_t)strtoul(args[i + 2], NULL, 0);
+		}
+		status = godice_open_leds_packet(packet, sizeof(packet), &size,
+										 colors[0], colors[1], colors[2],
+										 colors[3], colors[4], colors[5]);
+	} else {
+		return "syntax";
+	}
+	if (status != GODICE_OK) {
+		return "internal";
+	}
+	return route_command(gateway, dice_id, packet, size);
+}
+
+static void incoming_subscriber_data(gateway_t *gateway, connection_t *connection) {
+	size_t offset = 0;
+	while (offset < connection->in_size) {
+		uint8_t *line = connection->in + offset;
+		uint8_t *end = memchr(line, '\n', connection->in_size - offset);
+		if (end == NULL) {
+			break;
+		}
+		*end = '\0';
+		const char *error = subscriber_command(gateway, connection, (char*)line);
+		bool replied = error == NULL
+			? send_line(gateway, connection, "ok\n")
+			: send_line(gateway, connection, "error %s\n", error);
+		if (!replied) {
+			connection->dropped++;
+		}
+		offset = (size_t)(end - connection->in) + 1;
+	}
+	memmove(connection->in, connection->in + offset, connection->in_size - offset);
+	connection->in_size -= offset;
+	// Longer lines are never valid commands
+	if (connection->in_size == sizeof(connection->in)) {
+		connection->in_size = 0;
+	}
+}
+
+static void accept_connection(gateway_t *gateway, connection_t *listener) {
+	int fd = accept(listener->fd, NULL, NULL);
+	if (fd < 0) {
+		return;
+	}
+	connection_kind_t kind = listener->kind == CONNECTION_SOURCES_LISTENER
+		? CONNECTION_SOURCE
+		: CONNECTION_SUBSCRIBER;
+	connection_t *connection = add_connection(gateway, fd, kind);
+	if (connection == NULL) {
+		close(fd);
+		return;
+	}
+	if (kind == CONNECTION_SUBSCRIBER) {
+		update_events_mask(gateway);
+	}
+}
+
+static void read_connection(gateway_t *gateway, connection_t *connection) {
+	if (connection->kind == CONNECTION_SOURCES_LISTENER || connection->kind == CONNECTION_SUBSCRIBERS_LISTENER) {
+		accept_connection(gateway, connection);
+		return;
+	}
+	ssize_t result = read(connection->fd, connection->in + connection->in_size,
+						  sizeof(connection->in) - connection->in_size);
+	if (result < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) {
+		return;
+	}
+	if (result <= 0) {
+		close_connection(gateway, connection);
+		return;
+	}
+	connection->in_size += (size_t)result;
+	if (connection->kind == CONNECTION_SUBSCRIBER) {
+		incoming_subscriber_data(gateway, connection);
+		update_polling(gateway, connection);
+	} else if (!incoming_source_data(gateway, connection)) {
+		fprintf(stderr, "godice-gateway: malformed frame, closing source\n");
+		close_connection(gateway, connection);
+	}
+}
+
+static void write_connection(gateway_t *gateway, connection_t *connection) {
+	if (!flush_connection(connection)) {
+		close_connection(gateway, connection);
+		return;
+	}
+	if (connection->kind == CONNECTION_SUBSCRIBER && connection->dropped > 0 &&
+		send_line(gateway, connection, "dropped %llu\n", (unsigned long long)connection->dropped)) {
+		connection->dropped = 0;
+	}
+	update_polling(gateway, connection);
+}
+
+static int listen_unix(const char *path) {
+	int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (fd < 0) {
+		return -1;
+	}
+	struct sockaddr_un address = { .sun_family = AF_UNIX };
+	if (strlen(path) >= sizeof(address.sun_path)) {
+		close(fd);
+		errno = ENAMETOOLONG;
+		return -1;
+	}
+	strcpy(address.sun_path, path);
+	unlink(path);
+	if (bind(fd, (struct sockaddr*)&address, sizeof(address)) != 0 || listen(fd, 16) != 0) {
+		close(fd);
+		return -1;
+	}
+	return fd;
+}
+
+static void usage(void) {
+	fprintf(stderr,
+			"usage: godice-gateway [--sources PATH] [--subscribers PATH] [--state FILE] [--replay FILE]...\n"
+			"  --sources PATH      UNIX socket accepting dice sources (default /tmp/godice-sources.sock)\n"
+			"  --subscribers PATH  UNIX socket accepting subscribers (default /tmp/godice-events.sock)\n"
+			"  --state FILE        keep last known dice state in FILE across restarts\n"
+			"  --replay FILE       read frames from capture file or pipe, may be repeated\n");
+}
+
+int main(int argc, char **argv) {
+	const char *sources_path = "/tmp/godice-sources.sock";
+	const char *subscribers_path = "/tmp/godice-events.sock";
+	static const struct option options[] = {
+		{ "sources", required_argument, NULL, 's' },
+		{ "subscribers", required_argument, NULL, 'p' },
+		{ "state", required_argument, NULL, 't' },
+		{ "replay", required_argument, NULL, 'r' },
+		{ "help", no_argument, NULL, 'h' },
+		{ NULL, 0, NULL, 0 },
+	};
+
+	gateway_t *gateway = &g_gateway;
+	gateway->epoll_fd = epoll_create1(0);
+	if (gateway->epoll_fd < 0) {
+		perror("godice-gateway: epoll_create1");
+		return EXIT_FAILURE;
+	}
+	gateway->callbacks.on_dice_color = on_dice_color;
+	gateway->callbacks.on_dice_stable_kind = on_dice_stable_kind;
+	gateway->callbacks.on_charging_state_chaged = on_charging_state_changed;
+	gateway->callbacks.on_charge_level = on_charge_level;
+	gateway->callbacks.on_dice_roll = on_dice_roll;
+	gateway->callbacks.on_dice_tap = on_dice_tap;
+	gateway->callbacks.on_dice_double_tap = on_dice_double_tap;
+
+	int option;
+	while ((option = getopt_long(argc, argv, "s:p:t:r:h", options, NULL)) != -1) {
+		switch (option) {
+			case 's':
+				sources_path = optarg;
+				break;
+			case 'p':
+				subscribers_path = optarg;
+				break;
+			case 't':
+				if (gateway->store != NULL || godice_store_open(&gateway->store, optarg, GATEWAY_STORE_CAPACITY) != GODICE_OK) {
+					fprintf(stderr, "godice-gateway: can't open state %s\n", optarg);
+					return EXIT_FAILURE;
+				}
+				update_events_mask(gateway);
+				break;
+			case 'r': {
+				int fd = strcmp(optarg, "-") == 0 ? dup(STDIN_FILENO) : open(optarg, O_RDONLY);
+				if (fd < 0 || add_connection(gateway, fd, CONNECTION_REPLAY) == NULL) {
+					fprintf(stderr, "godice-gateway: can't replay %s: %s\n", optarg, strerror(errno));
+					return EXIT_FAILURE;
+				}
+				break;
+			}
+			default:
+				usage();
+				return option == 'h' ? EXIT_SUCCESS : EXIT_FAILURE;
+		}
+	}
+
+	int sources_fd = listen_unix(sources_path);
+	int subscribers_fd = listen_unix(subscribers_path);
+	if (sources_fd < 0 || subscribers_fd < 0) {
+		perror("godice-gateway: listen");
+		return EXIT_FAILURE;
+	}
+	add_connection(gateway, sources_fd, CONNECTION_SOURCES_LISTENER);
+	add_connection(gateway, subscribers_fd, CONNECTION_SUBSCRIBERS_LISTENER);
+
+	struct sigaction action = { .sa_handler = on_signal };
+	sigaction(SIGINT, &action, NULL);
+	sigaction(SIGTERM, &action, NULL);
+	signal(SIGPIPE, SIG_IGN);
+
+	struct epoll_event events[GATEWAY_MAX_EVENTS];
+	while (!g_stop) {
+		bool paused = replays_paused(gateway);
+		if (paused != gateway->paused) {
+			gateway->paused = paused;
+			for (size_t i = 0; i < countof(gateway->connections); i++) {
+				if (gateway->connections[i].kind == CONNECTION_REPLAY) {
+					update_polling(gateway, &gateway->connections[i]);
+				}
+			}
+		}
+		int events_num = epoll_wait(gateway->epoll_fd, events, countof(events),
+									gateway->unpolled_num > 0 && !paused ? 0 : -1);
+		if (events_num < 0 && errno != EINTR) {
+			perror("godice-gateway: epoll_wait");
+			break;
+		}
+		for (int i = 0; i < events_num; i++) {
+			connection_t *connection = events[i].data.ptr;
+			if (connection->kind != CONNECTION_FREE && (events[i].events & EPOLLOUT)) {
+				write_connection(gateway, connection);
+			}
+			if (connection->kind != CONNECTION_FREE && (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR))) {
+				read_connection(gateway, connection);
+			}
+		}
+		for (size_t i = 0; i < countof(gateway->connections) && gateway->unpolled_num > 0 && !paused; i++) {
+			connection_t *connection = &gateway->connections[i];
+			if (connection->kind != CONNECTION_FREE && !connection->pollable) {
+				read_connection(gateway, connection);
+			}
+		}
+	}
+
+	unlink(sources_path);
+	unlink(subscribers_path);
+	if (gateway->store != NULL) {
+		godice_store_close(gateway->store);
+	}
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,144 @@
+#include "godiceapi.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define TRAIN_DICE 64
+#define TRAIN_PACKETS (1 << 20)
+#define TRAIN_MAX_PACKET_SIZE 5
+
+typedef struct {
+	uint8_t dice;
+	uint8_t size;
+	uint8_t data[TRAIN_MAX_PACKET_SIZE];
+} packet_t;
+
+static const int DiceMax[] = { 4, 6, 8, 10, 12, 20, 100 };
+
+static uint32_t g_random = 2463534242u;
+
+static uint32_t next_random(void) {
+	// xorshift32, fixed seed for reproducible profiles
+	g_random ^= g_random << 13;
+	g_random ^= g_random >> 17;
+	g_random ^= g_random << 5;
+	return g_random;
+}
+
+static void random_axis(uint8_t *axis) {
+	double x, y, z, length;
+	do {
+		x = (double)(next_random() % 2001) / 1000.0 - 1.0;
+		y = (double)(next_random() % 2001) / 1000.0 - 1.0;
+		z = (double)(next_random() % 2001) / 1000.0 - 1.0;
+		length = sqrt(x * x + y * y + z * z);
+	} while (length < 0.1 || length > 1.0);
+	axis[0] = (uint8_t)(int8_t)lround(x / length * 64.0);
+	axis[1] = (uint8_t)(int8_t)lround(y / length * 64.0);
+	axis[2] = (uint8_t)(int8_t)lround(z / length * 64.0);
+}
+
+static void set_packet(packet_t *packet, const char *prefix, size_t payload_size) {
+	packet->size = (uint8_t)(strlen(prefix) + payload_size);
+	memcpy(packet->data, prefix, strlen(prefix));
+}
+
+// Traffic of a table: mostly rolls and stable results, some battery, charging, color and taps
+static void generate_packet(packet_t *packet) {
+	packet->dice = (uint8_t)(next_random() % TRAIN_DICE);
+	uint32_t kind = next_random() % 100;
+	if (kind < 35) {
+		set_packet(packet, "R", 0);
+	} else if (kind < 75) {
+		set_packet(packet, "S", 3);
+		random_axis(packet->data + 1);
+	} else if (kind < 85) {
+		static const char *Stables[] = { "FS", "MS", "TS" };
+		set_packet(packet, Stables[next_random() % 3], 3);
+		random_axis(packet->data + 2);
+	} else if (kind < 91) {
+		set_packet(packet, "Bat", 1);
+		packet->data[3] = (uint8_t)(next_random() % 101);
+	} else if (kind < 94) {
+		set_packet(packet, "Char", 1);
+		packet->data[4] = (uint8_t)(next_random() % 2);
+	} else if (kind < 96) {
+		set_packet(packet, "Col", 1);
+		packet->data[3] = (uint8_t)(next_random() % 6);
+	} else if (kind < 99) {
+		set_packet(packet, "Tap", 0);
+	} else {
+		set_packet(packet, "DTap", 0);
+	}
+}
+
+static void on_dice_color(void *userdata, int dice_id, godice_color_t color) {
+	(void)dice_id;
+	*(uint64_t*)userdata += (uint64_t)color;
+}
+
+static void on_dice_stable_kind(void *userdata, int dice_id, uint8_t number, godice_stable_kind_t kind) {
+	(void)dice_id;
+	(void)kind;
+	*(uint64_t*)userdata += number;
+}
+
+static void on_charging_state_changed(void *userdata, int dice_id, bool charging) {
+	(void)dice_id;
+	*(uint64_t*)userdata += charging;
+}
+
+static void on_charge_level(void *userdata, int dice_id, uint8_t level) {
+	(void)dice_id;
+	*(uint64_t*)userdata += level;
+}
+
+static void on_dice_event(void *userdata, int dice_id) {
+	(void)dice_id;
+	*(uint64_t*)userdata += 1;
+}
+
+int main(int argc, char **argv) {
+	int passes = argc > 1 ? atoi(argv[1]) : 20;
+	packet_t *packets = malloc(TRAIN_PACKETS * sizeof(packet_t));
+	if (packets == NULL || passes <= 0) {
+		fprintf(stderr, "usage: godice-train [PASSES]\n");
+		return EXIT_FAILURE;
+	}
+	for (size_t i = 0; i < TRAIN_PACKETS; i++) {
+		generate_packet(&packets[i]);
+	}
+
+	godice_callbacks_t callbacks = { 0 };
+	callbacks.on_dice_color = on_dice_color;
+	callbacks.on_dice_stable_kind = on_dice_stable_kind;
+	callbacks.on_charging_state_chaged = on_charging_state_changed;
+	callbacks.on_charge_level = on_charge_level;
+	callbacks.on_dice_roll = on_dice_event;
+	callbacks.on_dice_tap = on_dice_event;
+	callbacks.on_dice_double_tap = on_dice_event;
+	godice_dice_state_t states[TRAIN_DICE];
+	for (int i = 0; i < TRAIN_DICE; i++) {
+		godice_dice_state_reset(&states[i]);
+	}
+
+	uint64_t checksum = 0;
+	struct timespec start, end;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (int pass = 0; pass < passes; pass++) {
+		for (size_t i = 0; i < TRAIN_PACKETS; i++) {
+			const packet_t *packet = &packets[i];
+			int dice_max = DiceMax[packet->dice % (sizeof(DiceMax) / sizeof(DiceMax[0]))];
+			godice_incoming_packet_tracked(&callbacks, &checksum, &states[packet->dice], packet->dice, dice_max,
+										   packet->data, packet->size);
+		}
+	}
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	double seconds = (double)(end.tv_sec - start.tv_sec) + (double)(end.tv_nsec - start.tv_nsec) / 1e9;
+	printf("%.1f ns/packet (checksum %llu)\n", seconds * 1e9 / ((double)passes * TRAIN_PACKETS),
+		   (unsigned long long)checksum);
+	free(packets);
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,231 @@
+#include "godiceredecode.h"
+#include "frame.h"
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define REDECODE_MAX_THREADS 256
+// Captures are split in this many parts per thread to even out the load
+#define REDECODE_PARTS_PER_THREAD 8
+
+typedef struct {
+	size_t begin;
+	size_t end;
+	uint64_t first_stable;
+	uint64_t frames;
+	uint64_t stables;
+	uint64_t changed;
+	uint64_t unknown;
+	godice_redecode_diff_t *diffs;
+	size_t diffs_num;
+	size_t diffs_capacity;
+	godice_status_t status;
+} part_t;
+
+typedef struct {
+	const uint8_t *capture;
+	const godice_redecode_remap_t *remaps;
+	size_t remaps_num;
+	uint8_t *faces;
+	part_t *parts;
+	size_t parts_num;
+	size_t next_part;
+	pthread_mutex_t lock;
+} redecode_t;
+
+static bool is_stable_packet(const uint8_t *packet, size_t size) {
+	godice_event_t event = godice_packet_event(packet, size);
+	return (event & GODICE_EVENTS_STABLE_ALL) != 0;
+}
+
+static int remapped_dice_max(const redecode_t *redecode, int dice_max) {
+	for (size_t i = 0; i < redecode->remaps_num; i++) {
+		if (redecode->remaps[i].from_dice_max == dice_max) {
+			return redecode->remaps[i].to_dice_max;
+		}
+	}
+	return dice_max;
+}
+
+static bool add_diff(part_t *part, const godice_redecode_diff_t *diff) {
+	if (part->diffs_num == part->diffs_capacity) {
+		size_t capacity = part->diffs_capacity == 0 ? 256 : part->diffs_capacity * 2;
+		godice_redecode_diff_t *diffs = realloc(part->diffs, capacity * sizeof(*diffs));
+		if (diffs == NULL) {
+			return false;
+		}
+		part->diffs = diffs;
+		part->diffs_capacity = capacity;
+	}
+	part->diffs[part->diffs_num++] = *diff;
+	return true;
+}
+
+static void redecode_part(redecode_t *redecode, part_t *part) {
+	size_t offset = part->begin;
+	uint64_t stable_index = part->first_stable;
+	while (offset < part->end) {
+		frame_t frame;
+		int frame_size = frame_parse(redecode->capture + offset, part->end - offset, &frame);
+		if (frame_size <= 0) {
+			part->status = GODICE_INVALID_PACKET;
+			return;
+		}
+		offset += (size_t)frame_size;
+		part->frames++;
+		if (frame.type != FRAME_NOTIFY || !is_stable_packet(frame.packet, frame.packet_size)) {
+			continue;
+		}
+		part->stables++;
+		godice_classification_t original;
+		godice_classification_t corrected;
+		int to_dice_max = remapped_dice_max(redecode, frame.dice_max);
+		bool known = godice_classify_stable_packet(frame.dice_max, frame.packet, frame.packet_size, &original) == GODICE_OK &&
+			godice_classify_stable_packet(to_dice_max, frame.packet, frame.packet_size, &corrected) == GODICE_OK;
+		if (!known) {
+			part->unknown++;
+			corrected.value = GODICE_REDECODE_UNKNOWN;
+		} else if (original.value != corrected.value) {
+			part->changed++;
+			godice_redecode_diff_t diff = {
+				stable_index, frame.dice_id, frame.dice_max, original.value, corrected.value,
+			};
+			if (!add_diff(part, &diff)) {
+				part->status = GODICE_LIMIT_REACHED;
+				return;
+			}
+		}
+		if (redecode->faces != NULL) {
+			redecode->faces[stable_index] = corrected.value;
+		}
+		stable_index++;
+	}
+}
+
+static void *redecode_worker(void *arg) {
+	redecode_t *redecode = arg;
+	for (;;) {
+		pthread_mutex_lock(&redecode->lock);
+		size_t index = redecode->next_part++;
+		pthread_mutex_unlock(&redecode->lock);
+		if (index >= redecode->parts_num) {
+			return NULL;
+		}
+		redecode_part(redecode, &redecode->parts[index]);
+	}
+}
+
+// Walks frame headers only, splitting the capture into parts of about `part_size` bytes and
+// counting stable packets before each part
+static godice_status_t split_capture(const uint8_t *capture, size_t size, size_t part_size,
+									 part_t *parts, size_t parts_capacity, size_t *parts_num,
+									 godice_redecode_stats_t *stats) {
+	memset(stats, 0, sizeof(*stats));
+	size_t offset = 0;
+	size_t count = 0;
+	while (offset < size) {
+		if (parts != NULL && (count == 0 || (offset - parts[count - 1].begin >= part_size && count < parts_capacity))) {
+			memset(&parts[count], 0, sizeof(part_t));
+			parts[count].begin = offset;
+			parts[count].first_stable = stats->stables;
+			if (count > 0) {
+				parts[count - 1].end = offset;
+			}
+			count++;
+		}
+		frame_t frame;
+		int frame_size = frame_parse(capture + offset, size - offset, &frame);
+		if (frame_size < 0) {
+			return GODICE_INVALID_PACKET;
+		}
+		if (frame_size == 0) {
+			// Truncated last frame of a capture that was not closed cleanly
+			break;
+		}
+		offset += (size_t)frame_size;
+		stats->frames++;
+		if (frame.type == FRAME_NOTIFY && is_stable_packet(frame.packet, frame.packet_size)) {
+			stats->stables++;
+		}
+	}
+	if (count > 0) {
+		parts[count - 1].end = offset;
+	}
+	if (parts_num != NULL) {
+		*parts_num = count;
+	}
+	return GODICE_OK;
+}
+
+godice_status_t godice_redecode_count(const uint8_t *capture, size_t size, godice_redecode_stats_t *stats) {
+	return split_capture(capture, size, 0, NULL, 0, NULL, stats);
+}
+
+godice_status_t godice_redecode(const uint8_t *capture, size_t size,
+								const godice_redecode_remap_t *remaps, size_t remaps_num,
+								int threads, uint8_t *faces, size_t faces_size,
+								godice_redecode_diff_cb diff_callback, void *userdata,
+								godice_redecode_stats_t *stats) {
+	if (threads <= 0) {
+		long cores = sysconf(_SC_NPROCESSORS_ONLN);
+		threads = cores > 0 ? (int)cores : 1;
+	}
+	if (threads > REDECODE_MAX_THREADS) {
+		threads = REDECODE_MAX_THREADS;
+	}
+	size_t parts_capacity = (size_t)threads * REDECODE_PARTS_PER_THREAD;
+	part_t *parts = calloc(parts_capacity, sizeof(part_t));
+	if (parts == NULL) {
+		return GODICE_LIMIT_REACHED;
+	}
+	size_t parts_num;
+	godice_redecode_stats_t counted;
+	godice_status_t status = split_capture(capture, size, size / parts_capacity + 1,
+										   parts, parts_capacity, &parts_num, &counted);
+	if (status == GODICE_OK && faces != NULL && faces_size < counted.stables) {
+		status = GODICE_BUFFER_TOO_SMALL;
+	}
+	if (status != GODICE_OK) {
+		free(parts);
+		return status;
+	}
+
+	redecode_t redecode;
+	memset(&redecode, 0, sizeof(redecode));
+	redecode.capture = capture;
+	redecode.remaps = remaps;
+	redecode.remaps_num = remaps_num;
+	redecode.faces = faces;
+	redecode.parts = parts;
+	redecode.parts_num = parts_num;
+	pthread_mutex_init(&redecode.lock, NULL);
+	pthread_t handles[REDECODE_MAX_THREADS];
+	int started = 0;
+	while (started < threads - 1 && pthread_create(&handles[started], NULL, redecode_worker, &redecode) == 0) {
+		started++;
+	}
+	redecode_worker(&redecode);
+	for (int i = 0; i < started; i++) {
+		pthread_join(handles[i], NULL);
+	}
+	pthread_mutex_destroy(&redecode.lock);
+
+	memset(stats, 0, sizeof(*stats));
+	for (size_t i = 0; i < parts_num; i++) {
+		part_t *part = &parts[i];
+		if (part->status != GODICE_OK) {
+			status = part->status;
+		}
+		stats->frames += part->frames;
+		stats->stables += part->stables;
+		stats->changed += part->changed;
+		stats->unknown += part->unknown;
+		for (size_t d = 0; diff_callback != NULL && d < part->diffs_num; d++) {
+			diff_callback(userdata, &part->diffs[d]);
+		}
+		free(part->diffs);
+	}
+	free(parts);
+	return status;
+}
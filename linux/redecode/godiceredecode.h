@@ -0,0 +1,58 @@
+#ifndef __GODICESDK_GODICEREDECODE_H
+#define __GODICESDK_GODICEREDECODE_H
+
+#include "godiceapi.h"
+
+// Offline re-decoding of stable packets stored in gateway capture files (see gateway/frame.h).
+// Every "S", "FS", "MS" and "TS" packet is classified twice: with the dice type it was captured
+// with and with the type it is remapped to, e.g. a registered shell with a corrected face table.
+
+// Face value of stable packets of unknown dice types, 0 is a valid face of D10 and D10X
+#define GODICE_REDECODE_UNKNOWN 0xff
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+	int from_dice_max;
+	int to_dice_max;
+} godice_redecode_remap_t;
+
+typedef struct {
+	// Index of the stable packet among all stable packets of the capture
+	uint64_t stable_index;
+	uint32_t dice_id;
+	uint8_t dice_max;
+	uint8_t original;
+	uint8_t corrected;
+} godice_redecode_diff_t;
+
+typedef struct {
+	uint64_t frames;
+	uint64_t stables;
+	uint64_t changed;
+	// Stable packets of dice types that are not known
+	uint64_t unknown;
+} godice_redecode_stats_t;
+
+// Called once per changed packet, in capture order, from the calling thread
+typedef void (*godice_redecode_diff_cb)(void *userdata, const godice_redecode_diff_t *diff);
+
+// Counts stable packets of a capture, used to size `faces` output
+godice_status_t godice_redecode_count(const uint8_t *capture, size_t size, godice_redecode_stats_t *stats);
+
+// Re-decodes `capture` on `threads` threads (0 - one per core). If `faces` is not NULL it
+// receives corrected value of every stable packet in capture order (GODICE_REDECODE_UNKNOWN for
+// unknown dice types) and must hold `stats.stables` bytes as counted by `godice_redecode_count`.
+godice_status_t godice_redecode(const uint8_t *capture, size_t size,
+								const godice_redecode_remap_t *remaps, size_t remaps_num,
+								int threads, uint8_t *faces, size_t faces_size,
+								godice_redecode_diff_cb diff_callback, void *userdata,
+								godice_redecode_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __GODICESDK_GODICEREDECODE_H
@@ -0,0 +1,203 @@
+#include "godiceredecode.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#define MAX_REMAPS 16
+
+// Shell definition file registers a dice type with corrected face table:
+//   <dice type id> <name>
+//   <x> <y> <z> <value>      one line per face, '#' starts a comment
+static bool load_shell(const char *path) {
+	FILE *file = fopen(path, "r");
+	if (file == NULL) {
+		fprintf(stderr, "godice-redecode: can't open %s: %s\n", path, strerror(errno));
+		return false;
+	}
+	int dice_max = -1;
+	char name[GODICE_DICE_TYPE_NAME_SIZE] = "";
+	godice_axis_t faces[GODICE_MAX_DICE_FACES];
+	uint8_t values[GODICE_MAX_DICE_FACES];
+	size_t faces_num = 0;
+	bool valid = true;
+	char line[256];
+	while (valid && fgets(line, sizeof(line), file) != NULL) {
+		char *comment = strchr(line, '#');
+		if (comment != NULL) {
+			*comment = '\0';
+		}
+		int x, y, z, value;
+		char extra;
+		if (sscanf(line, " %c", &extra) != 1) {
+			continue;
+		}
+		if (dice_max < 0) {
+			valid = sscanf(line, "%d %15s", &dice_max, name) == 2;
+		} else if (faces_num < GODICE_MAX_DICE_FACES && sscanf(line, "%d %d %d %d", &x, &y, &z, &value) == 4 &&
+				   x >= INT8_MIN && x <= INT8_MAX && y >= INT8_MIN && y <= INT8_MAX &&
+				   z >= INT8_MIN && z <= INT8_MAX && value >= 0 && value <= UINT8_MAX) {
+			faces[faces_num] = (godice_axis_t){ (int8_t)x, (int8_t)y, (int8_t)z };
+			values[faces_num] = (uint8_t)value;
+			faces_num++;
+		} else {
+			valid = false;
+		}
+	}
+	fclose(file);
+	if (!valid || godice_register_dice_type(dice_max, name, faces, values, faces_num) != GODICE_OK) {
+		fprintf(stderr, "godice-redecode: invalid shell definition %s\n", path);
+		return false;
+	}
+	return true;
+}
+
+static void on_diff(void *userdata, const godice_redecode_diff_t *diff) {
+	const char *name = godice_dice_type_name(diff->dice_max);
+	fprintf(userdata, "%llu %u %s %u %u\n", (unsigned long long)diff->stable_index, diff->dice_id,
+			name != NULL ? name : "?", diff->original, diff->corrected);
+}
+
+static void usage(void) {
+	fprintf(stderr,
+			"usage: godice-redecode [options] CAPTURE\n"
+			"  --shell FILE       register dice type from shell definition file, may be repeated\n"
+			"  --remap FROM=TO    classify packets of dice type FROM as type TO, may be repeated\n"
+			"  --faces FILE       write corrected value of every stable packet, one byte each\n"
+			"                     (255 for unknown dice types)\n"
+			"  --diff FILE        write changed packets: <index> <dice> <type> <original> <corrected>\n"
+			"  --threads N        decoding threads (default one per core)\n");
+}
+
+int main(int argc, char **argv) {
+	const char *faces_path = NULL;
+	const char *diff_path = NULL;
+	int threads = 0;
+	godice_redecode_remap_t remaps[MAX_REMAPS];
+	size_t remaps_num = 0;
+	static const struct option options[] = {
+		{ "shell", required_argument, NULL, 's' },
+		{ "remap", required_argument, NULL, 'r' },
+		{ "faces", required_argument, NULL, 'f' },
+		{ "diff", required_argument, NULL, 'd' },
+		{ "threads", required_argument, NULL, 't' },
+		{ "help", no_argument, NULL, 'h' },
+		{ NULL, 0, NULL, 0 },
+	};
+
+	int option;
+	while ((option = getopt_long(argc, argv, "s:r:f:d:t:h", options, NULL)) != -1) {
+		switch (option) {
+			case 's':
+				if (!load_shell(optarg)) {
+					return EXIT_FAILURE;
+				}
+				break;
+			case 'r':
+				if (remaps_num == MAX_REMAPS ||
+					sscanf(optarg, "%d=%d", &remaps[remaps_num].from_dice_max, &remaps[remaps_num].to_dice_max) != 2) {
+					usage();
+					return EXIT_FAILURE;
+				}
+				remaps_num++;
+				break;
+			case 'f':
+				faces_path = optarg;
+				break;
+			case 'd':
+				diff_path = optarg;
+				break;
+			case 't':
+				threads = atoi(optarg);
+				break;
+			default:
+				usage();
+				return option == 'h' ? EXIT_SUCCESS : EXIT_FAILURE;
+		}
+	}
+	if (optind != argc - 1) {
+		usage();
+		return EXIT_FAILURE;
+	}
+
+	const char *capture_path = argv[optind];
+	int fd = open(capture_path, O_RDONLY);
+	struct stat st;
+	if (fd < 0 || fstat(fd, &st) != 0) {
+		fprintf(stderr, "godice-redecode: can't open %s: %s\n", capture_path, strerror(errno));
+		return EXIT_FAILURE;
+	}
+	size_t size = (size_t)st.st_size;
+	const uint8_t *capture = NULL;
+	if (size > 0) {
+		capture = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (capture == MAP_FAILED) {
+			perror("godice-redecode: mmap");
+			return EXIT_FAILURE;
+		}
+		madvise((void*)capture, size, MADV_SEQUENTIAL);
+	}
+	close(fd);
+
+	godice_redecode_stats_t stats;
+	if (godice_redecode_count(capture, size, &stats) != GODICE_OK) {
+		fprintf(stderr, "godice-redecode: %s is not a capture\n", capture_path);
+		return EXIT_FAILURE;
+	}
+
+	// Every thread writes values of its own part of capture straight to the mapped file
+	uint8_t *faces = NULL;
+	if (faces_path != NULL) {
+		int faces_fd = open(faces_path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+		if (faces_fd < 0 || ftruncate(faces_fd, (off_t)stats.stables) != 0) {
+			fprintf(stderr, "godice-redecode: can't write %s: %s\n", faces_path, strerror(errno));
+			return EXIT_FAILURE;
+		}
+		if (stats.stables > 0) {
+			faces = mmap(NULL, stats.stables, PROT_READ | PROT_WRITE, MAP_SHARED, faces_fd, 0);
+			if (faces == MAP_FAILED) {
+				perror("godice-redecode: mmap");
+				return EXIT_FAILURE;
+			}
+		}
+		close(faces_fd);
+	}
+	FILE *diff = NULL;
+	if (diff_path != NULL) {
+		diff = strcmp(diff_path, "-") == 0 ? stdout : fopen(diff_path, "w");
+		if (diff == NULL) {
+			fprintf(stderr, "godice-redecode: can't write %s: %s\n", diff_path, strerror(errno));
+			return EXIT_FAILURE;
+		}
+	}
+
+	struct timespec start, end;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	godice_status_t status = godice_redecode(capture, size, remaps, remaps_num, threads,
+											 faces, stats.stables, diff != NULL ? on_diff : NULL, diff, &stats);
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	double seconds = (double)(end.tv_sec - start.tv_sec) + (double)(end.tv_nsec - start.tv_nsec) / 1e9;
+
+	if (faces != NULL && (msync(faces, stats.stables, MS_SYNC) != 0 || munmap(faces, stats.stables) != 0)) {
+		perror("godice-redecode: faces");
+		status = GODICE_IO_ERROR;
+	}
+	if (diff != NULL && (fflush(diff) != 0 || (diff != stdout && fclose(diff) != 0))) {
+		perror("godice-redecode: diff");
+		status = GODICE_IO_ERROR;
+	}
+	fprintf(stderr, "%llu frames, %llu stable, %llu changed, %llu unknown dice type in %.3f s\n",
+			(unsigned long long)stats.frames, (unsigned long long)stats.stables,
+			(unsigned long long)stats.changed, (unsigned long long)stats.unknown, seconds);
+	if (status != GODICE_OK) {
+		fprintf(stderr, "godice-redecode: failed with status %d\n", status);
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
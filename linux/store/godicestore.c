@@ -0,0 +1,283 @@
+#include "godicestore.h"
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static const char StoreMagic[4] = { 'G', 'D', 'S', 'T' };
+
+#define SLOT_FREE 0xff
+
+typedef struct {
+	char magic[4];
+	uint32_t version;
+	// Size of `storeCopy_t`, files of builds with other layout are reset
+	uint32_t copy_size;
+	uint32_t capacity;
+} storeHeader_t;
+
+typedef struct {
+	// 0 - never written
+	uint64_t sequence;
+	uint32_t checksum;
+	uint32_t reserved;
+	godice_store_record_t record;
+} storeCopy_t;
+
+typedef struct {
+	storeCopy_t copies[2];
+} storeSlot_t;
+
+struct godice_store {
+	int fd;
+	uint8_t *data;
+	size_t size;
+	storeSlot_t *slots;
+	uint32_t capacity;
+	// Used slots in insertion order
+	uint32_t *order;
+	uint32_t count;
+	// Open addressing table of slot + 1 by dice id, 0 - empty
+	uint32_t *index;
+	uint32_t index_mask;
+	// Per slot: current copy (SLOT_FREE if none) and stale fields
+	uint8_t *current;
+	uint32_t *stale;
+};
+
+static uint32_t copy_checksum(uint64_t sequence, const godice_store_record_t *record) {
+	// FNV-1a
+	uint32_t hash = 2166136261u;
+	const uint8_t *bytes = (const uint8_t*)&sequence;
+	for (size_t i = 0; i < sizeof(sequence); i++) {
+		hash = (hash ^ bytes[i]) * 16777619u;
+	}
+	bytes = (const uint8_t*)record;
+	for (size_t i = 0; i < sizeof(*record); i++) {
+		hash = (hash ^ bytes[i]) * 16777619u;
+	}
+	return hash;
+}
+
+static bool is_valid_copy(const storeCopy_t *copy) {
+	return copy->sequence != 0 && copy->checksum == copy_checksum(copy->sequence, &copy->record);
+}
+
+static uint32_t *index_find(const godice_store_t *store, uint32_t dice_id) {
+	for (uint32_t index = (dice_id * 2654435761u) & store->index_mask; ; index = (index + 1) & store->index_mask) {
+		uint32_t *entry = &store->index[index];
+		if (*entry == 0 || store->slots[*entry - 1].copies[store->current[*entry - 1]].record.dice_id == dice_id) {
+			return entry;
+		}
+	}
+}
+
+static const godice_store_record_t *current_record(const godice_store_t *store, uint32_t slot) {
+	return &store->slots[slot].copies[store->current[slot]].record;
+}
+
+static void free_store(godice_store_t *store) {
+	if (store->data != NULL) {
+		munmap(store->data, store->size);
+	}
+	if (store->fd >= 0) {
+		close(store->fd);
+	}
+	free(store->order);
+	free(store->index);
+	free(store->current);
+	free(store->stale);
+	free(store);
+}
+
+// Maps the file, resetting it if it is not a valid store
+static godice_status_t map_store(godice_store_t *store, size_t capacity) {
+	struct stat st;
+	if (fstat(store->fd, &st) != 0) {
+		return GODICE_IO_ERROR;
+	}
+	storeHeader_t header;
+	bool valid = (size_t)st.st_size >= sizeof(header) &&
+		pread(store->fd, &header, sizeof(header), 0) == (ssize_t)sizeof(header) &&
+		memcmp(header.magic, StoreMagic, sizeof(StoreMagic)) == 0 &&
+		header.version == GODICE_STORE_VERSION &&
+		header.copy_size == sizeof(storeCopy_t) &&
+		header.capacity > 0 &&
+		(size_t)st.st_size == sizeof(header) + header.capacity * sizeof(storeSlot_t);
+	if (!valid) {
+		if (capacity == 0 || capacity > UINT32_MAX / 2) {
+			return GODICE_INVALID_ARGUMENT;
+		}
+		memcpy(header.magic, StoreMagic, sizeof(StoreMagic));
+		header.version = GODICE_STORE_VERSION;
+		header.copy_size = sizeof(storeCopy_t);
+		header.capacity = (uint32_t)capacity;
+		// Header is written after zeroed slots, an interrupted reset is reset again
+		if (ftruncate(store->fd, 0) != 0 ||
+			ftruncate(store->fd, (off_t)(sizeof(header) + capacity * sizeof(storeSlot_t))) != 0 ||
+			fdatasync(store->fd) != 0 ||
+			pwrite(store->fd, &header, sizeof(header), 0) != (ssize_t)sizeof(header)) {
+			return GODICE_IO_ERROR;
+		}
+	}
+	store->capacity = header.capacity;
+	store->size = sizeof(header) + header.capacity * sizeof(storeSlot_t);
+	void *data = mmap(NULL, store->size, PROT_READ | PROT_WRITE, MAP_SHARED, store->fd, 0);
+	if (data == MAP_FAILED) {
+		return GODICE_IO_ERROR;
+	}
+	store->data = data;
+	store->slots = (storeSlot_t*)(store->data + sizeof(header));
+	return GODICE_OK;
+}
+
+godice_status_t godice_store_open(godice_store_t **store, const char *path, size_t capacity) {
+	godice_store_t *result = calloc(1, sizeof(*result));
+	if (result == NULL) {
+		return GODICE_LIMIT_REACHED;
+	}
+	result->fd = open(path, O_RDWR | O_CREAT, 0644);
+	if (result->fd < 0) {
+		free_store(result);
+		return GODICE_IO_ERROR;
+	}
+	godice_status_t status = map_store(result, capacity);
+	if (status != GODICE_OK) {
+		free_store(result);
+		return status;
+	}
+
+	uint32_t index_size = 1;
+	while (index_size < result->capacity * 2) {
+		index_size *= 2;
+	}
+	result->index_mask = index_size - 1;
+	result->index = calloc(index_size, sizeof(uint32_t));
+	result->order = calloc(result->capacity, sizeof(uint32_t));
+	result->current = calloc(result->capacity, sizeof(uint8_t));
+	result->stale = calloc(result->capacity, sizeof(uint32_t));
+	if (result->index == NULL || result->order == NULL || result->current == NULL || result->stale == NULL) {
+		free_store(result);
+		return GODICE_LIMIT_REACHED;
+	}
+	memset(result->current, SLOT_FREE, result->capacity);
+
+	for (uint32_t slot = 0; slot < result->capacity; slot++) {
+		const storeCopy_t *copies = result->slots[slot].copies;
+		bool valid[2] = { is_valid_copy(&copies[0]), is_valid_copy(&copies[1]) };
+		if (!valid[0] && !valid[1]) {
+			continue;
+		}
+		uint8_t current = valid[1] && (!valid[0] || copies[1].sequence > copies[0].sequence);
+		uint32_t *entry = index_find(result, copies[current].record.dice_id);
+		// Only a corrupted file has one dice twice, its other slots are left free
+		if (*entry != 0) {
+			continue;
+		}
+		result->current[slot] = current;
+		const godice_store_record_t *record = current_record(result, slot);
+		*entry = slot + 1;
+		result->order[result->count++] = slot;
+		result->stale[slot] = record->fields & GODICE_STORE_REVALIDATED_FIELDS;
+	}
+	*store = result;
+	return GODICE_OK;
+}
+
+void godice_store_close(godice_store_t *store) {
+	godice_store_sync(store);
+	free_store(store);
+}
+
+godice_status_t godice_store_sync(godice_store_t *store) {
+	return msync(store->data, store->size, MS_SYNC) == 0 ? GODICE_OK : GODICE_IO_ERROR;
+}
+
+size_t godice_store_count(const godice_store_t *store) {
+	return store->count;
+}
+
+godice_status_t godice_store_at(const godice_store_t *store, size_t index, godice_store_record_t *record) {
+	if (index >= store->count) {
+		return GODICE_INVALID_ARGUMENT;
+	}
+	memcpy(record, current_record(store, store->order[index]), sizeof(*record));
+	return GODICE_OK;
+}
+
+godice_status_t godice_store_get(const godice_store_t *store, uint32_t dice_id, godice_store_record_t *record) {
+	uint32_t entry = *index_find(store, dice_id);
+	if (entry == 0) {
+		return GODICE_INVALID_ARGUMENT;
+	}
+	memcpy(record, current_record(store, entry - 1), sizeof(*record));
+	return GODICE_OK;
+}
+
+uint32_t godice_store_stale(const godice_store_t *store, uint32_t dice_id) {
+	uint32_t entry = *index_find(store, dice_id);
+	return entry == 0 ? 0 : store->stale[entry - 1];
+}
+
+static void copy_fields(godice_store_record_t *record, uint32_t fields, const godice_store_record_t *values) {
+	if (fields & GODICE_STORE_COLOR) {
+		record->color = values->color;
+	}
+	if (fields & GODICE_STORE_CHARGE_LEVEL) {
+		record->charge_level = values->charge_level;
+	}
+	if (fields & GODICE_STORE_CHARGING) {
+		record->charging = values->charging;
+	}
+	if (fields & GODICE_STORE_DICE_TYPE) {
+		record->dice_type = values->dice_type;
+	}
+	if (fields & GODICE_STORE_DETECTION_SETTINGS) {
+		record->detection_settings = values->detection_settings;
+	}
+	if (fields & GODICE_STORE_CALIBRATION) {
+		record->calibration = values->calibration;
+	}
+	record->fields |= fields;
+}
+
+godice_status_t godice_store_update(godice_store_t *store, uint32_t fields, const godice_store_record_t *values) {
+	uint32_t *entry = index_find(store, values->dice_id);
+	uint32_t slot;
+	storeCopy_t copy;
+	memset(&copy, 0, sizeof(copy));
+	if (*entry != 0) {
+		slot = *entry - 1;
+		const storeCopy_t *current = &store->slots[slot].copies[store->current[slot]];
+		copy.sequence = current->sequence + 1;
+		// Copied bytewise, checksum covers padding too
+		memcpy(&copy.record, &current->record, sizeof(copy.record));
+	} else {
+		if (store->count == store->capacity) {
+			return GODICE_LIMIT_REACHED;
+		}
+		slot = 0;
+		while (store->current[slot] != SLOT_FREE) {
+			slot++;
+		}
+		// Free slots may hold torn or duplicate copies, both are overwritten
+		memset(&store->slots[slot], 0, sizeof(storeSlot_t));
+		store->current[slot] = 1;
+		copy.sequence = 1;
+		copy.record.dice_id = values->dice_id;
+	}
+	copy_fields(&copy.record, fields, values);
+	copy.checksum = copy_checksum(copy.sequence, &copy.record);
+
+	uint8_t next = store->current[slot] ^ 1;
+	memcpy(&store->slots[slot].copies[next], &copy, sizeof(copy));
+	store->current[slot] = next;
+	if (*entry == 0) {
+		*entry = slot + 1;
+		store->order[store->count++] = slot;
+	}
+	store->stale[slot] &= ~fields;
+	return GODICE_OK;
+}
@@ -0,0 +1,72 @@
+#ifndef __GODICESDK_GODICESTORE_H
+#define __GODICESDK_GODICESTORE_H
+
+#include "godiceapi.h"
+#include "godicetuner.h"
+
+// Persistent last known state of dice, kept in a memory-mapped file so it is available right
+// after restart without asking every dice again.
+//
+// Every dice has a slot with two copies of its record. Updates are written to the older copy
+// together with a higher sequence number and a checksum, so a record torn by a crash fails the
+// checksum and the previous copy is used. Records reach disk on `godice_store_sync` or whenever
+// the kernel writes pages back. Files use host byte order and layout, and are reset when they
+// were written by a build with different record layout.
+
+#define GODICE_STORE_VERSION 1
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+GODICE_ENUM_BEGIN(godice_store_field_t)
+	GODICE_STORE_COLOR = 1 << 0,
+	GODICE_STORE_CHARGE_LEVEL = 1 << 1,
+	GODICE_STORE_CHARGING = 1 << 2,
+	GODICE_STORE_DICE_TYPE = 1 << 3,
+	GODICE_STORE_DETECTION_SETTINGS = 1 << 4,
+	GODICE_STORE_CALIBRATION = 1 << 5,
+GODICE_ENUM_END(godice_store_field_t)
+
+// Fields reported by dice on request, they are stale after the store is opened until updated
+#define GODICE_STORE_REVALIDATED_FIELDS (GODICE_STORE_COLOR | GODICE_STORE_CHARGE_LEVEL | \
+										 GODICE_STORE_CHARGING | GODICE_STORE_DICE_TYPE)
+
+typedef struct {
+	uint32_t dice_id;
+	// `godice_store_field_t` flags of fields holding a value
+	uint32_t fields;
+	int32_t color;
+	uint8_t charge_level;
+	bool charging;
+	// `dice_max` of the dice shell
+	uint8_t dice_type;
+	godice_detection_settings_t detection_settings;
+	godice_calibration_t calibration;
+} godice_store_record_t;
+
+typedef struct godice_store godice_store_t;
+
+// Opens or creates store file with room for `capacity` dice. Existing files keep their capacity.
+godice_status_t godice_store_open(godice_store_t **store, const char *path, size_t capacity);
+// Syncs and unmaps the store
+void godice_store_close(godice_store_t *store);
+// Waits until all updates are on disk
+godice_status_t godice_store_sync(godice_store_t *store);
+
+size_t godice_store_count(const godice_store_t *store);
+// Copies record number `index` (0 .. count - 1), records are kept in insertion order
+godice_status_t godice_store_at(const godice_store_t *store, size_t index, godice_store_record_t *record);
+// Copies record of `dice_id`, returns GODICE_INVALID_ARGUMENT if dice is not stored
+godice_status_t godice_store_get(const godice_store_t *store, uint32_t dice_id, godice_store_record_t *record);
+// Copies `fields` from `values` into record of `values->dice_id`, creating it if needed,
+// and clears their stale flags
+godice_status_t godice_store_update(godice_store_t *store, uint32_t fields, const godice_store_record_t *values);
+// Returns fields of `dice_id` that were loaded from file and not updated since
+uint32_t godice_store_stale(const godice_store_t *store, uint32_t dice_id);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __GODICESDK_GODICESTORE_H
@@ -0,0 +1,462 @@
+#include <iostream>
+#include <cassert>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "godicearchive.h"
+#include "godiceredecode.h"
+#include "godicestore.h"
+#include "frame.h"
+#include <poll.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace std;
+
+static vector<godice_wire_event_t> sample_events(size_t count) {
+	vector<godice_wire_event_t> events;
+	uint64_t timestamp = 1700000000000ull;
+	for (size_t i = 0; i < count; i++) {
+		timestamp += i % 7;
+		uint32_t dice_id = (uint32_t)(i * 31 % 50);
+		bool roll = i % 2 == 0;
+		events.push_back({ timestamp, dice_id,
+						   roll ? GODICE_EVENT_ROLL : GODICE_EVENT_STABLE,
+						   (uint8_t)(roll ? 0 : i % 20 + 1) });
+	}
+	return events;
+}
+
+struct scan_result_t {
+	atomic<uint64_t> count{0};
+	atomic<uint64_t> value_sum{0};
+};
+
+void test_archive() {
+	char dir[] = "/tmp/godice-archive-XXXXXX";
+	assert(mkdtemp(dir) != nullptr);
+	string path_string = string(dir) + "/test.gdar";
+	const char *path = path_string.c_str();
+	vector<godice_wire_event_t> events = sample_events(3 * GODICE_ARCHIVE_CHUNK_ROWS + 1000);
+
+	godice_archive_writer_t *writer;
+	assert(godice_archive_writer_open(&writer, path) == GODICE_OK);
+	for (const godice_wire_event_t &event : events) {
+		assert(godice_archive_writer_add(writer, &event) == GODICE_OK);
+	}
+	assert(godice_archive_writer_close(writer) == GODICE_OK);
+
+	godice_archive_t *archive;
+	assert(godice_archive_open(&archive, path) == GODICE_OK);
+	assert(godice_archive_rows(archive) == events.size());
+	assert(godice_archive_chunks(archive) == 4);
+
+	godice_archive_filter_t filter = { 7, events[1000].timestamp_ms, events[70000].timestamp_ms };
+	uint64_t expected_count = 0;
+	uint64_t expected_sum = 0;
+	for (const godice_wire_event_t &event : events) {
+		if (event.dice_id == filter.dice_id &&
+			event.timestamp_ms >= filter.from_ms && event.timestamp_ms <= filter.to_ms) {
+			expected_count++;
+			expected_sum += event.value;
+		}
+	}
+
+	scan_result_t result;
+	size_t scanned;
+	assert(godice_archive_scan(archive, &filter, 4, [](void *userdata, int thread, const godice_wire_event_t *event) {
+		(void)thread;
+		scan_result_t *result = (scan_result_t*)userdata;
+		result->count++;
+		result->value_sum += event->value;
+	}, &result, &scanned) == GODICE_OK);
+	assert(result.count == expected_count);
+	assert(result.value_sum == expected_sum);
+	assert(scanned == 2);
+
+	godice_archive_close(archive);
+
+	// Rows hold a single event
+	assert(godice_archive_writer_open(&writer, path) == GODICE_OK);
+	godice_wire_event_t mixed = events[0];
+	mixed.event = (godice_event_t)(GODICE_EVENT_ROLL | GODICE_EVENT_STABLE);
+	assert(godice_archive_writer_add(writer, &mixed) == GODICE_INVALID_ARGUMENT);
+	assert(godice_archive_writer_add(writer, &events[1]) == GODICE_OK);
+	assert(godice_archive_writer_close(writer) == GODICE_OK);
+	assert(godice_archive_open(&archive, path) == GODICE_OK);
+	assert(godice_archive_rows(archive) == 1);
+	godice_archive_close(archive);
+
+	// Corrupted value column width of the chunk index entry, 86 bytes in, is rejected
+	FILE *file = fopen(path, "r+b");
+	uint64_t index_offset;
+	assert(fseek(file, -32, SEEK_END) == 0 && fread(&index_offset, sizeof(index_offset), 1, file) == 1);
+	assert(fseek(file, (long)index_offset + 86, SEEK_SET) == 0 && fputc(200, file) == 200);
+	fclose(file);
+	assert(godice_archive_open(&archive, path) == GODICE_INVALID_PACKET);
+	remove(path);
+	rmdir(dir);
+
+	// Failed chunk write leaves the writer failed instead of overrunning the chunk
+	assert(godice_archive_writer_open(&writer, "/dev/full") == GODICE_OK);
+	for (size_t i = 0; i < GODICE_ARCHIVE_CHUNK_ROWS - 1; i++) {
+		assert(godice_archive_writer_add(writer, &events[i]) == GODICE_OK);
+	}
+	assert(godice_archive_writer_add(writer, &events[0]) == GODICE_IO_ERROR);
+	assert(godice_archive_writer_add(writer, &events[1]) == GODICE_IO_ERROR);
+	assert(godice_archive_writer_close(writer) == GODICE_IO_ERROR);
+}
+
+struct diff_result_t {
+	vector<godice_redecode_diff_t> diffs;
+};
+
+void test_redecode() {
+	// D6 shell with 2 and 5 swapped
+	const godice_axis_t faces[] = {
+		{ -64, 0, 0 }, { 0, 0, -64 }, { 0, 64, 0 }, { 0, -64, 0 }, { 0, 0, 64 }, { 64, 0, 0 },
+	};
+	const uint8_t values[] = { 1, 2, 3, 4, 5, 6 };
+	assert(godice_register_dice_type(106, "D6SWAP", faces, values, 6) == GODICE_OK);
+
+	vector<uint8_t> capture;
+	uint64_t stables = 0;
+	for (uint32_t i = 0; i < 100000; i++) {
+		const godice_axis_t &face = faces[i % 6];
+		int noise = (int)(i % 9) - 4;
+		uint8_t stable[] = { 'S', (uint8_t)(face.x + noise), (uint8_t)(face.y - noise), (uint8_t)(face.z + noise) };
+		uint8_t fake_stable[] = { 'F', 'S', (uint8_t)(i * 3), 0, (uint8_t)-64 };
+		uint8_t roll[] = { 'R' };
+		frame_t frame = { FRAME_NOTIFY, i % 10, (uint8_t)(i % 3 == 0 ? 20 : 6), stable, sizeof(stable) };
+		if (i % 5 == 0) {
+			frame.packet = roll;
+			frame.packet_size = sizeof(roll);
+		} else if (i % 5 == 1) {
+			frame.packet = fake_stable;
+			frame.packet_size = sizeof(fake_stable);
+			stables++;
+		} else {
+			stables++;
+		}
+		uint8_t buffer[FRAME_MAX_SIZE];
+		size_t size = frame_write(buffer, sizeof(buffer), &frame);
+		capture.insert(capture.end(), buffer, buffer + size);
+	}
+	// Truncated frame at the end is ignored
+	capture.push_back(5);
+
+	godice_redecode_stats_t counted;
+	assert(godice_redecode_count(capture.data(), capture.size(), &counted) == GODICE_OK);
+	assert(counted.frames == 100000 && counted.stables == stables);
+
+	godice_redecode_remap_t remap = { 6, 106 };
+	vector<uint8_t> single(stables);
+	vector<uint8_t> parallel(stables);
+	diff_result_t single_diffs;
+	diff_result_t parallel_diffs;
+	auto collect = [](void *userdata, const godice_redecode_diff_t *diff) {
+		((diff_result_t*)userdata)->diffs.push_back(*diff);
+	};
+	godice_redecode_stats_t stats;
+	assert(godice_redecode(capture.data(), capture.size(), &remap, 1, 1, single.data(), single.size(),
+						   collect, &single_diffs, &stats) == GODICE_OK);
+	assert(stats.stables == stables && stats.unknown == 0 && stats.changed == single_diffs.diffs.size());
+	assert(stats.changed > 0);
+	assert(godice_redecode(capture.data(), capture.size(), &remap, 1, 8, parallel.data(), parallel.size(),
+						   collect, &parallel_diffs, &stats) == GODICE_OK);
+	assert(single == parallel);
+	assert(parallel_diffs.diffs.size() == single_diffs.diffs.size());
+
+	uint64_t previous = 0;
+	for (const godice_redecode_diff_t &diff : parallel_diffs.diffs) {
+		assert(diff.stable_index >= previous);
+		previous = diff.stable_index;
+		assert(diff.dice_max == 6);
+		assert((diff.original == 2 && diff.corrected == 5) || (diff.original == 5 && diff.corrected == 2));
+		assert(parallel[diff.stable_index] == diff.corrected);
+	}
+
+	uint8_t small[1];
+	assert(godice_redecode(capture.data(), capture.size(), &remap, 1, 2, small, sizeof(small),
+						   NULL, NULL, &stats) == GODICE_BUFFER_TOO_SMALL);
+	// Dice types that are not registered can't be told from a face value
+	uint8_t stable_one[] = { 'S', (uint8_t)-64, 0, 0 };
+	frame_t unknown_frame = { FRAME_NOTIFY, 1, 7, stable_one, sizeof(stable_one) };
+	uint8_t unknown_capture[FRAME_MAX_SIZE];
+	size_t unknown_size = frame_write(unknown_capture, sizeof(unknown_capture), &unknown_frame);
+	uint8_t unknown_face = 0;
+	assert(godice_redecode(unknown_capture, unknown_size, NULL, 0, 1, &unknown_face, 1, NULL, NULL, &stats) == GODICE_OK);
+	assert(stats.unknown == 1 && unknown_face == GODICE_REDECODE_UNKNOWN);
+	uint8_t garbage[] = { 3, 0, 9, 9, 9 };
+	assert(godice_redecode(garbage, sizeof(garbage), NULL, 0, 2, NULL, 0, NULL, NULL, &stats) == GODICE_INVALID_PACKET);
+}
+
+void test_store() {
+	char dir[] = "/tmp/godice-store-XXXXXX";
+	assert(mkdtemp(dir) != nullptr);
+	string path_string = string(dir) + "/test.gdst";
+	const char *path = path_string.c_str();
+	godice_store_t *store;
+	assert(godice_store_open(&store, path, 4) == GODICE_OK);
+	assert(godice_store_count(store) == 0);
+
+	godice_store_record_t values = {};
+	values.dice_id = 42;
+	values.color = GODICE_RED;
+	values.charge_level = 80;
+	values.dice_type = 20;
+	assert(godice_store_update(store, GODICE_STORE_COLOR | GODICE_STORE_CHARGE_LEVEL | GODICE_STORE_DICE_TYPE, &values) == GODICE_OK);
+	values.dice_id = 7;
+	assert(godice_calibration_init(&values.calibration, 6) == GODICE_OK);
+	values.detection_settings.samples_count = GODICE_SAMPLES_COUNT_DEFAULT;
+	assert(godice_store_update(store, GODICE_STORE_CALIBRATION | GODICE_STORE_DETECTION_SETTINGS, &values) == GODICE_OK);
+	values.dice_id = 42;
+	values.charge_level = 75;
+	assert(godice_store_update(store, GODICE_STORE_CHARGE_LEVEL, &values) == GODICE_OK);
+	assert(godice_store_stale(store, 42) == 0);
+	for (uint32_t dice_id = 100; dice_id < 102; dice_id++) {
+		values.dice_id = dice_id;
+		assert(godice_store_update(store, GODICE_STORE_COLOR, &values) == GODICE_OK);
+	}
+	values.dice_id = 103;
+	assert(godice_store_update(store, GODICE_STORE_COLOR, &values) == GODICE_LIMIT_REACHED);
+	godice_store_close(store);
+
+	// Capacity of existing file is kept, revalidated fields are stale after reopening
+	assert(godice_store_open(&store, path, 100) == GODICE_OK);
+	assert(godice_store_count(store) == 4);
+	godice_store_record_t record;
+	assert(godice_store_at(store, 0, &record) == GODICE_OK && record.dice_id == 42);
+	assert(godice_store_get(store, 42, &record) == GODICE_OK);
+	assert(record.fields == (GODICE_STORE_COLOR | GODICE_STORE_CHARGE_LEVEL | GODICE_STORE_DICE_TYPE));
+	assert(record.color == GODICE_RED && record.charge_level == 75 && record.dice_type == 20);
+	assert(godice_store_stale(store, 42) == record.fields);
+	assert(godice_store_get(store, 7, &record) == GODICE_OK);
+	assert(record.calibration.dice_max == 6 && record.calibration.faces_num == 6);
+	assert(godice_store_stale(store, 7) == 0);
+	assert(godice_store_get(store, 8, &record) == GODICE_INVALID_ARGUMENT);
+	values.dice_id = 42;
+	values.color = GODICE_BLUE;
+	assert(godice_store_update(store, GODICE_STORE_COLOR, &values) == GODICE_OK);
+	assert(godice_store_stale(store, 42) == (GODICE_STORE_CHARGE_LEVEL | GODICE_STORE_DICE_TYPE));
+	godice_store_close(store);
+
+	// Torn update of the newest copy falls back to the previous one
+	FILE *file = fopen(path, "r+b");
+	assert(file != NULL);
+	vector<uint8_t> data(1 << 16);
+	data.resize(fread(data.data(), 1, data.size(), file));
+	size_t color_offset = 0;
+	for (size_t i = 0; i + sizeof(int32_t) <= data.size(); i++) {
+		int32_t color;
+		memcpy(&color, &data[i], sizeof(color));
+		if (color == GODICE_BLUE && i >= 8 && data[i - 8] == 42) {
+			color_offset = i;
+		}
+	}
+	assert(color_offset != 0);
+	data[color_offset] ^= 0xff;
+	fseek(file, 0, SEEK_SET);
+	fwrite(data.data(), 1, data.size(), file);
+	fclose(file);
+	assert(godice_store_open(&store, path, 4) == GODICE_OK);
+	assert(godice_store_get(store, 42, &record) == GODICE_OK);
+	assert(record.color == GODICE_RED && record.charge_level == 75);
+	godice_store_close(store);
+	remove(path);
+	rmdir(dir);
+}
+
+static pid_t spawn(const vector<string> &args) {
+	pid_t pid = fork();
+	if (pid == 0) {
+		vector<char*> argv;
+		for (const string &arg : args) {
+			argv.push_back((char*)arg.c_str());
+		}
+		argv.push_back(nullptr);
+		execv(argv[0], argv.data());
+		_exit(127);
+	}
+	return pid;
+}
+
+static int connect_unix(const string &path) {
+	struct sockaddr_un address = {};
+	address.sun_family = AF_UNIX;
+	strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+	// Gateway may not listen yet
+	for (int i = 0; i < 100; i++) {
+		int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+		if (connect(fd, (struct sockaddr*)&address, sizeof(address)) == 0) {
+			return fd;
+		}
+		close(fd);
+		usleep(20000);
+	}
+	return -1;
+}
+
+// Next line from subscriber socket, empty on timeout
+static string read_line(int fd, string &buffer) {
+	size_t end;
+	while ((end = buffer.find('\n')) == string::npos) {
+		struct pollfd poll_fd = { fd, POLLIN, 0 };
+		char data[256];
+		ssize_t size;
+		if (poll(&poll_fd, 1, 5000) <= 0 || (size = read(fd, data, sizeof(data))) <= 0) {
+			return string();
+		}
+		buffer.append(data, (size_t)size);
+	}
+	string line = buffer.substr(0, end);
+	buffer.erase(0, end + 1);
+	return line;
+}
+
+// Next frame written to a source socket, false on timeout
+static bool read_frame(int fd, vector<uint8_t> &buffer, vector<uint8_t> &frame_data, frame_t *frame) {
+	for (;;) {
+		int size = frame_parse(buffer.data(), buffer.size(), frame);
+		assert(size >= 0);
+		if (size > 0) {
+			frame_data.assign(buffer.begin(), buffer.begin() + size);
+			buffer.erase(buffer.begin(), buffer.begin() + size);
+			frame_parse(frame_data.data(), frame_data.size(), frame);
+			return true;
+		}
+		struct pollfd poll_fd = { fd, POLLIN, 0 };
+		uint8_t data[256];
+		ssize_t read_size;
+		if (poll(&poll_fd, 1, 5000) <= 0 || (read_size = read(fd, data, sizeof(data))) <= 0) {
+			return false;
+		}
+		buffer.insert(buffer.end(), data, data + read_size);
+	}
+}
+
+static void write_notify(int fd, uint32_t dice_id, const uint8_t *packet, size_t size) {
+	uint8_t buffer[FRAME_MAX_SIZE];
+	frame_t frame = { FRAME_NOTIFY, dice_id, 6, packet, size };
+	size_t frame_size = frame_write(buffer, sizeof(buffer), &frame);
+	assert(write(fd, buffer, frame_size) == (ssize_t)frame_size);
+}
+
+static void write_command(int fd, const char *command) {
+	assert(write(fd, command, strlen(command)) == (ssize_t)strlen(command));
+}
+
+void test_gateway() {
+	char dir[] = "/tmp/godice-gateway-XXXXXX";
+	assert(mkdtemp(dir) != nullptr);
+	string sources = string(dir) + "/sources.sock";
+	string subscribers = string(dir) + "/events.sock";
+	pid_t gateway = spawn({ GATEWAY_PATH, "--sources", sources, "--subscribers", subscribers });
+	int fd = connect_unix(subscribers);
+	assert(fd >= 0);
+	string buffer;
+	const char command[] = "events stable\n";
+	assert(write(fd, command, strlen(command)) == (ssize_t)strlen(command));
+	assert(read_line(fd, buffer) == "ok");
+
+	// Subscribers of stable results only get every result, also on the same face
+	pid_t fakedice = spawn({ FAKEDICE_PATH, "--sources", sources, "--dice", "1", "--rolls", "3",
+							 "--face", "5", "--interval", "20" });
+	for (int i = 0; i < 3; i++) {
+		assert(read_line(fd, buffer) == "stable 0 5 S");
+	}
+	int status;
+	assert(waitpid(fakedice, &status, 0) == fakedice && WIFEXITED(status) && WEXITSTATUS(status) == 0);
+
+	close(fd);
+	kill(gateway, SIGTERM);
+	assert(waitpid(gateway, &status, 0) == gateway && WIFEXITED(status) && WEXITSTATUS(status) == 0);
+	rmdir(dir);
+}
+
+// Commands reach the source the dice reported through, stored state is revalidated
+void test_gateway_commands() {
+	char dir[] = "/tmp/godice-commands-XXXXXX";
+	assert(mkdtemp(dir) != nullptr);
+	string sources = string(dir) + "/sources.sock";
+	string subscribers = string(dir) + "/events.sock";
+	string state = string(dir) + "/state.gdst";
+
+	// Color known from before the restart
+	godice_store_t *store;
+	assert(godice_store_open(&store, state.c_str(), 16) == GODICE_OK);
+	godice_store_record_t values = {};
+	values.dice_id = 9;
+	values.color = GODICE_RED;
+	assert(godice_store_update(store, GODICE_STORE_COLOR, &values) == GODICE_OK);
+	godice_store_close(store);
+
+	pid_t gateway = spawn({ GATEWAY_PATH, "--sources", sources, "--subscribers", subscribers, "--state", state });
+	int subscriber = connect_unix(subscribers);
+	assert(subscriber >= 0);
+	string lines;
+	write_command(subscriber, "events color\n");
+	assert(read_line(subscriber, lines) == "ok");
+	write_command(subscriber, "state 9\n");
+	assert(read_line(subscriber, lines) == "state 9 1 - - - stale");
+	assert(read_line(subscriber, lines) == "ok");
+	write_command(subscriber, "get-color 9\n");
+	assert(read_line(subscriber, lines) == "error unknown-dice");
+
+	// First frame of the dice asks it for the stale color
+	int source = connect_unix(sources);
+	assert(source >= 0);
+	const uint8_t roll[] = { 'R' };
+	write_notify(source, 9, roll, sizeof(roll));
+	vector<uint8_t> frames;
+	vector<uint8_t> frame_data;
+	frame_t frame;
+	uint8_t expected[FRAME_MAX_PACKET_SIZE];
+	size_t expected_size;
+	assert(read_frame(source, frames, frame_data, &frame));
+	assert(godice_get_color_packet(expected, sizeof(expected), &expected_size) == GODICE_OK);
+	assert(frame.type == FRAME_WRITE && frame.dice_id == 9);
+	assert(frame.packet_size == expected_size && memcmp(frame.packet, expected, expected_size) == 0);
+
+	const uint8_t color[] = { 'C', 'o', 'l', GODICE_BLUE };
+	write_notify(source, 9, color, sizeof(color));
+	assert(read_line(subscriber, lines) == "color 9 3");
+	write_command(subscriber, "state 9\n");
+	assert(read_line(subscriber, lines) == string("state 9 3 - - ") + godice_dice_type_name(6) + " fresh");
+	assert(read_line(subscriber, lines) == "ok");
+
+	// Subscriber commands are written to the source of the dice
+	write_command(subscriber, "leds 9 255 0 0 0 0 255\n");
+	assert(read_line(subscriber, lines) == "ok");
+	assert(read_frame(source, frames, frame_data, &frame));
+	assert(godice_open_leds_packet(expected, sizeof(expected), &expected_size, 255, 0, 0, 0, 0, 255) == GODICE_OK);
+	assert(frame.type == FRAME_WRITE && frame.dice_id == 9);
+	assert(frame.packet_size == expected_size && memcmp(frame.packet, expected, expected_size) == 0);
+	write_command(subscriber, "get-color 9\n");
+	assert(read_line(subscriber, lines) == "ok");
+	assert(read_frame(source, frames, frame_data, &frame));
+	assert(godice_get_color_packet(expected, sizeof(expected), &expected_size) == GODICE_OK);
+	assert(frame.packet_size == expected_size && memcmp(frame.packet, expected, expected_size) == 0);
+
+	close(source);
+	close(subscriber);
+	int status;
+	kill(gateway, SIGTERM);
+	assert(waitpid(gateway, &status, 0) == gateway && WIFEXITED(status) && WEXITSTATUS(status) == 0);
+	remove(state.c_str());
+	rmdir(dir);
+}
+
+int main() {
+	test_archive();
+	test_redecode();
+	test_store();
+	test_gateway();
+	test_gateway_commands();
+	return 0;
+}